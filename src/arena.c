@@ -0,0 +1,124 @@
+/**
+ * This file is the per-line arena allocator for Hank Shell.
+ * Everything that lives only as long as one command line (its syntax
+ * tree, words, resolved pathnames and the prompt) is bump-allocated
+ * from the arena, which is reset in O(1) once the line is done.
+ * When a line outgrows the arena, extra blocks are chained; on reset
+ * they are merged into a single block large enough for that line, so
+ * in steady state a command line costs no malloc() at all.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define ARENA_MIN_SIZE 16384	/* size of the first block */
+#define ARENA_ALIGN    16	/* alignment of every allocation */
+
+/* A block of memory allocations are carved from */
+typedef struct arena_block {
+    struct arena_block *prev;	/* previously filled block */
+    size_t size;		/* # of bytes in data */
+    size_t used;		/* # of bytes handed out */
+    char data[];
+} ARENA_BLOCK;
+
+/* block allocations are currently made from */
+static ARENA_BLOCK *arena = (ARENA_BLOCK *) NULL;
+
+/* total size of all blocks in the chain */
+static size_t arena_total = 0;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Arena Helper Functions			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Chain a new block in front of the current one.
+ * @size: minimum # of bytes the new block must hold */
+static void arena_grow(size_t size)
+{
+    ARENA_BLOCK *block;
+
+    if (size < ARENA_MIN_SIZE)
+	size = ARENA_MIN_SIZE;
+    if (size < arena_total)		/* grow geometrically */
+	size = arena_total;
+
+    if (!(block = (ARENA_BLOCK *) malloc(sizeof(ARENA_BLOCK) + size)))
+	die_with_error("malloc");
+    block->prev = arena;
+    block->size = size;
+    block->used = 0;
+    arena = block;
+    arena_total += size;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    Arena Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Allocate memory living until the next arena_reset().
+ * @size: # of bytes needed
+ * @return: pointer to the memory; never NULL */
+void *arena_alloc(size_t size)
+{
+    void *p;
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+    if (!arena || arena->size - arena->used < size)
+	arena_grow(size);
+
+    p = arena->data + arena->used;
+    arena->used += size;
+    return p;
+}
+
+/* Copy a string into the arena.
+ * @s: the string
+ * @return: the copy; valid until the next arena_reset() */
+char *arena_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    return (char *) memcpy(arena_alloc(len), s, len);
+}
+
+/* Release everything allocated since the last reset. */
+void arena_reset(void)
+{
+    size_t total = arena_total;
+
+    if (!arena)
+	return;
+
+    /* the common case: a single block, just rewind it */
+    if (!arena->prev) {
+	arena->used = 0;
+	return;
+    }
+
+    /* the line outgrew the arena: merge the chain into one block */
+    arena_clean();
+    arena_grow(total);
+}
+
+/* Release all memory of the arena. */
+void arena_clean(void)
+{
+    ARENA_BLOCK *prev;
+
+    for (; arena; arena = prev) {
+	prev = arena->prev;
+	free(arena);
+    }
+    arena_total = 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * This file is the non-interactive (batch) interface for Hank Shell.
+ * Commands come from 'hsh -c string', 'hsh script' or a stdin that
+ * is not a terminal. Input is read in large chunks and executed line
+ * by line; readline, the prompt and history are never touched.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define BATCH_BUF_SIZE 65536	/* size of a single read() */
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	   Batch Mode Interface		     	     //
+// 	     	 						     //
+//===================================================================//
+
+/* Read commands from a file descriptor until EOF or 'exit'.
+ * Note that commands share the descriptor with hsh, so a command
+ * reading the same stdin sees input after hsh's read-ahead.
+ * @fd: file descriptor to read commands from
+ * @return: exit status of the last command executed */
+int execute_fd(int fd)
+{
+    char *buf, *line, *nl;
+    size_t cap = BATCH_BUF_SIZE, len = 0, pos = 0;
+    ssize_t n = 1;
+
+    if (!(buf = (char *) malloc(cap + 1)))
+	die_with_error("malloc");
+
+    while (1) {
+	/* execute every complete line in the buffer */
+	while ((nl = memchr(buf + pos, '\n', len - pos))) {
+	    *nl = '\0';
+	    line = buf + pos;
+	    pos = nl - buf + 1;
+	    if (-1 == execute_cmdline(line))
+		goto done;
+	}
+
+	/* last line without a trailing newline */
+	if (n == 0) {
+	    if (pos < len) {
+		buf[len] = '\0';
+		execute_cmdline(buf + pos);
+	    }
+	    break;
+	}
+
+	/* keep the partial line; grow buffer for very long lines */
+	memmove(buf, buf + pos, len - pos);
+	len -= pos;
+	pos = 0;
+	if (len == cap) {
+	    cap <<= 1;
+	    if (!(buf = (char *) realloc(buf, cap + 1)))
+		die_with_error("realloc");
+	}
+
+	while (-1 == (n = read(fd, buf + len, cap - len)) && errno == EINTR)
+	    ;
+	if (n == -1) {
+	    perror("read");
+	    break;
+	}
+	len += n;
+    }
+
+done:
+    free(buf);
+    return last_status;
+}
+
+/* Execute commands in a script file.
+ * @pathname: pathname of the script
+ * @return: exit status of the last command executed;
+ * 	    127 if the script can't be opened */
+int execute_file(const char *pathname)
+{
+    int fd, rel;
+
+    if (-1 == (fd = high_fd(open(pathname, O_RDONLY | O_CLOEXEC)))) {
+	fprintf(stderr, "-hsh: %s: %s\n", pathname, strerror(errno));
+	return 127;
+    }
+
+    rel = execute_fd(fd);
+    close(fd);
+    return rel;
+}
+
+/* Execute commands in a string as given to 'hsh -c'.
+ * @str: the commands; may contain several lines
+ * @return: exit status of the last command executed */
+int execute_string(const char *str)
+{
+    char *copy = dupstr((char *) str), *line, *nl;
+
+    for (line = copy; line; line = nl) {
+	if ((nl = strchr(line, '\n')))
+	    *nl++ = '\0';
+	if (-1 == execute_cmdline(line))
+	    break;
+    }
+
+    free(copy);
+    return last_status;
+}
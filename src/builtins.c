@@ -7,9 +7,10 @@
 #include "hsh.h"
 
 extern char cwd[];	// can't use char *cwd; i don't know why
-extern char rel_cwd[];	// can't use char *rel_cwd; i don't know why
 extern struct List dirs_stack;
 extern struct List paths_list;
+extern int last_status;
+extern char **environ;
 
 BUILTIN builtins[] = {
     { "exit", "Exit hsh"			   , builtin_exit },
@@ -21,8 +22,25 @@ BUILTIN builtins[] = {
     { "dirs", "Print directories on stack"	   , builtin_dirs },
     { "path", "Modify hsh search directory list"   , builtin_path },
     { "history", "Show command line history"	   , builtin_history },
-//    { "kill", "Kill processes"		   	   , builtin_kill },
-//    { "jobs", "Show current running jobs under hsh", builtin_jobs },
+    { "hash", "Show or modify command hash table"  , builtin_hash },
+    { "kill", "Kill processes"		   	   , builtin_kill },
+    { "jobs", "Show current running jobs under hsh", builtin_jobs },
+    { "wait", "Wait for background jobs"	   , builtin_wait },
+    { "fg", "Continue a job in the foreground"	   , builtin_fg },
+    { "bg", "Continue a job in the background"	   , builtin_bg },
+    { "parallel", "Run a command over a pool of jobs", builtin_parallel },
+    { "trace", "Show where hsh spends its time"	   , builtin_trace },
+    { "export", "Set environment variables"	   , builtin_export },
+    { "unset", "Remove environment variables"	   , builtin_unset },
+    { "pipesize", "Set the capacity of pipes"	   , builtin_pipesize },
+    { "true", "Do nothing, successfully"	   , builtin_true, 1 },
+    { "false", "Do nothing, unsuccessfully"	   , builtin_false, 1 },
+    { "test", "Evaluate a conditional expression"  , builtin_test, 1 },
+    { "[", "Evaluate a conditional expression"	   , builtin_test, 1 },
+    { "printf", "Format and print arguments"	   , builtin_printf, 1 },
+    { "cat", "Concatenate files to stdout"	   , builtin_cat, 1 },
+    { "basename", "Strip directory from file names", builtin_basename, 1 },
+    { "dirname", "Strip last component from names" , builtin_dirname, 1 },
     { (char*)NULL, (char*)NULL, (hsh_btfunc_t*)NULL }
 };
 
@@ -113,14 +131,14 @@ static int dirs_exception_hdlr(int nargs, char **args)
 /* History builtin exception handling
  * @nargs: # of arguments in command line
  * @args: command line argument buffer
- * @hlist: list of history entries
+ * @n_entries: # of history entries
  * @return: exception code; 0 for NO EXCEPTION OCCURS */
-static int his_exception_hdlr(int nargs, char **args, HIST_ENTRY **hlist)
+static int his_exception_hdlr(int nargs, char **args, long n_entries)
 {
 	int exception = 0;
 
 	/* check for NO HISTORY */
-	if (hlist == NULL)
+	if (n_entries == 0)
 		exception = -1;
 	/* a hack for atoi() funcion; this case is not an exception! */
 	else if (nargs >= 2 && strcmp(args[1], "0")==0)
@@ -129,7 +147,7 @@ static int his_exception_hdlr(int nargs, char **args, HIST_ENTRY **hlist)
 	else if (nargs >= 2 && !atoi(args[1]))
 		exception = 1;
 	/* check validity of numeric argument */
-	else if (nargs >= 2 && (atoi(args[1]) > history_length || 
+	else if (nargs >= 2 && (atoi(args[1]) > n_entries || 
 				atoi(args[1]) < 0))
 		exception = 2;
 
@@ -246,6 +264,22 @@ static void print_history(int n_of_entries, HIST_ENTRY **hlist)
 			hlist[history_length - i]->line);
 }
 
+/* Print an entry of the history file.
+ * @i: entry number, from 0 */
+static void print_hist_entry(uint32_t i)
+{
+	printf(" %u  %s\n", i + 1, hist_entry(i));
+}
+
+/* Print a single entry of command hash table.
+ * @hits: # of times the command was looked up
+ * @name: command name
+ * @path: hashed pathname of the command */
+static void print_hash_entry(int hits, const char *name, const char *path)
+{
+	printf("%4d\t%s\n", hits, path);
+}
+
 /* Pop directory stack helper funcion. */
 static void pop_dirs_stack()
 {
@@ -254,6 +288,7 @@ static void pop_dirs_stack()
 	} else {
 		free(top(&dirs_stack));
 		pop(&dirs_stack);
+		update_cwd();
 	}
 }
 
@@ -263,11 +298,17 @@ static void pop_dirs_stack()
 // 	     	 						     //
 //===================================================================//
 
-/* exit builtin function: exit Hsh program
+/* exit builtin function: exit Hsh program with status n 
+ * if given, otherwise with status of the last command
  * @nargs: # of arguments in command line
  * @args: command line argument buffer 
  * @return: 0 to continue loop; -1 to break */
-inline int builtin_exit(int nargs, char **args) { return -1; }
+int builtin_exit(int nargs, char **args)
+{
+	if (nargs >= 2)
+		last_status = atoi(args[1]) & 0377;
+	return -1;
+}
 
 /* cd builtin function: change working directory.
  * @nargs: # of arguments in command line
@@ -275,7 +316,11 @@ inline int builtin_exit(int nargs, char **args) { return -1; }
  * @return: -1 to break; otherwise continue loop */
 int builtin_cd(int nargs, char **args)
 {
-    return cd_exception_hdlr(nargs, args);
+    int rel;
+
+    if (!(rel = cd_exception_hdlr(nargs, args)))
+	update_cwd();
+    return rel;
 }
 
 /* echo builtin function: print command line args
@@ -295,7 +340,7 @@ int builtin_echo(int nargs, char **args)
  * @nargs: # of arguments in command line
  * @args: command line argument buffer 
  * @return: -1 to break; otherwise continue loop */
-inline int builtin_pwd(int nargs, char **args) { return printf("%s\n", cwd); }
+inline int builtin_pwd(int nargs, char **args) { printf("%s\n", cwd); return 0; }
 
 /* pushd builtin function: change working directory
  * and then push previous working directory onto stack
@@ -306,12 +351,13 @@ int builtin_pushd(int nargs, char **args)
 {
     /* check chdir exceptions */
     if (cd_exception_hdlr(nargs, args))
-	return 0;
+	return 1;
 	
     /* push directory to stack; but never push directory
      * that is identical to top element on the stack */
     if (is_empty(&dirs_stack) || strcmp(top(&dirs_stack), cwd))
 	push(&dirs_stack, dupstr(cwd));
+    update_cwd();
 
     /* print out directory stack */
     list_traversal(&dirs_stack, print_stack_element); 
@@ -329,7 +375,7 @@ int builtin_popd(int nargs, char **args)
 
 	/* check exception */
 	if (popd_exception_hdlr(nargs, args))
-		return 0;
+		return 1;
 
 	/* pop directory stack */
 	if (nargs == 1)
@@ -363,16 +409,40 @@ int builtin_dirs(int nargs, char **args)
  * @return: 0 to continue loop; -1 to break */
 int builtin_history(int nargs, char **args)
 {
-	HIST_ENTRY **the_list = history_list();
+	int exception;
+	uint32_t i, n;
+	const uint32_t *ids;
+	HIST_ENTRY **the_list;
+
+	/* no history file: the history of this session only */
+	if (hist_sync()) {
+		the_list = history_list();
+		if ((exception = his_exception_hdlr(nargs, args, 
+						the_list ? history_length : 0)))
+			return exception > 0;
+		print_history(nargs == 1 ? history_length : atoi(args[1]), the_list);
+		return 0;
+	}
+
+	/* history -p prefix, history -s text: search */
+	if (nargs == 3 && (!strcmp(args[1], "-p") || !strcmp(args[1], "-s"))) {
+		n = hist_find(args[2], args[1][1] == 'p', &ids);
+		for (i = 0; i < n; i++)
+			print_hist_entry(ids[i]);
+		return n == 0;
+	}
+
+	/* history -w: compact the history file now */
+	if (nargs == 2 && !strcmp(args[1], "-w"))
+		return hist_compact() ? 1 : 0;
 
 	/* check if exception occurs */
-	if (his_exception_hdlr(nargs, args, the_list))
-		return 0;
+	n = hist_count();
+	if ((exception = his_exception_hdlr(nargs, args, n)))
+		return exception > 0;
 
-	if (nargs == 1) 	
-		print_history(history_length, the_list);
-	else 
-		print_history(atoi(args[1]), the_list);
+	for (i = (nargs == 1) ? 0 : n - atoi(args[1]); i < n; i++)
+		print_hist_entry(i);
 	return 0;
 }
 
@@ -386,7 +456,7 @@ int builtin_path(int nargs, char **args)
 
     /* check for exceptions */
     if (path_exception_hdlr(nargs, args))
-	return 0;
+	return 1;
 
     /* path */
     if (nargs == 1) {
@@ -402,9 +472,104 @@ int builtin_path(int nargs, char **args)
 	remove_node(&paths_list, node);	
     }
 
+    /* hashed pathnames and completions may be stale now */
+    hash_clear();
+    complete_invalidate();
     return 0;
 }
 
+/* hash builtin function: show or modify command hash table
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 to continue loop; -1 to break */
+int builtin_hash(int nargs, char **args)
+{
+    int i, rel = 0;
+    char path[PATH_SIZE];
+
+    /* hash: list hashed commands */
+    if (nargs == 1) {
+	if (hash_size() == 0)
+	    printf("%s: hash table empty\n", args[0]);
+	else {
+	    printf("hits\tcommand\n");
+	    hash_traversal(print_hash_entry);
+	}
+	return 0;
+    }
+
+    /* hash -r: forget all remembered locations */
+    if (!strcmp(args[1], "-r")) {
+	hash_clear();
+	return 0;
+    }
+
+    /* hash name [name ...]: pre-seed hash table */
+    for (i = 1; i < nargs; i++) {
+	if (strchr(args[i], '/'))
+	    continue;
+	if (search_paths(&paths_list, args[i], path))
+	    hash_insert(args[i], path);
+	else {
+	    fprintf(stderr, "-hsh: %s: %s: not found\n", args[0], args[i]);
+	    rel = 1;
+	}
+    }
+    return rel;
+}
+
+/* export builtin function: set environment variables; every
+ * variable of hsh is in the environment, so 'export NAME' alone
+ * does nothing. The prompt may show some of them.
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 on success; 1 on an invalid name */
+int builtin_export(int nargs, char **args)
+{
+    int i, rel = 0;
+    char **env, *eq;
+
+    /* export: list the environment */
+    if (nargs == 1) {
+	for (env = environ; *env; env++)
+	    if ((eq = strchr(*env, '=')))
+		printf("export %.*s=\"%s\"\n", (int) (eq - *env), *env, eq + 1);
+	return 0;
+    }
+
+    /* export NAME=value [NAME=value ...] */
+    for (i = 1; i < nargs; i++) {
+	if (!(eq = strchr(args[i], '=')))
+	    continue;
+	*eq = '\0';
+	if (eq == args[i] || setenv(args[i], eq + 1, 1)) {
+	    fprintf(stderr, "-hsh: %s: `%s': not a valid identifier\n", args[0], args[i]);
+	    rel = 1;
+	}
+	*eq = '=';
+    }
+    prompt_invalidate(PROMPT_VARS);
+    return rel;
+}
+
+/* unset builtin function: remove environment variables
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 on success; 1 on an invalid name */
+int builtin_unset(int nargs, char **args)
+{
+    int i, rel = 0;
+
+    for (i = 1; i < nargs; i++) {
+	if (unsetenv(args[i])) {
+	    fprintf(stderr, "-hsh: %s: `%s': not a valid identifier\n", args[0], args[i]);
+	    rel = 1;
+	}
+    }
+    prompt_invalidate(PROMPT_VARS);
+    return rel;
+}
+
 //===================================================================//
 // 	     	 						     //
 // 	          Hank Shell List Clean-Up Functions	       	     //
@@ -0,0 +1,219 @@
+/**
+ * This file implements the command name index of Hank Shell's tab
+ * completion: the builtins and every executable in the directories
+ * of paths_list, sorted, so a prefix is completed by binary search.
+ *
+ * The index is built on the first completion and kept until it is
+ * stale: 'path +|-' invalidates it, and before each completion the
+ * directories are checked against the list and modification times
+ * they had when it was built (one stat per directory).
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern BUILTIN builtins[];
+extern struct List paths_list;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* A directory of the index, as it was when the index was built */
+typedef struct {
+    char *path;
+    struct timespec mtime;
+} INDEXED_DIR;
+
+static char *pool = (char *) NULL;	/* every name, '\0' terminated */
+static size_t pool_len = 0, pool_cap = 0;
+static uint32_t *names = (uint32_t *) NULL;	/* offsets in pool, sorted */
+static uint32_t n_names = 0, names_cap = 0;
+
+static INDEXED_DIR *dirs = (INDEXED_DIR *) NULL;
+static int n_dirs = 0;
+static int valid = 0;			/* the index was built and not invalidated */
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	   Index Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Add a name to the index, unsorted. */
+static void add_name(const char *name)
+{
+    size_t len = strlen(name) + 1;
+
+    if (pool_len + len > pool_cap) {
+	pool_cap = (pool_len + len) * 2;
+	if (!(pool = (char *) realloc(pool, pool_cap)))
+	    die_with_error("realloc");
+    }
+    if (n_names == names_cap) {
+	names_cap = names_cap ? names_cap * 2 : 256;
+	if (!(names = (uint32_t *) realloc(names, names_cap * sizeof(uint32_t))))
+	    die_with_error("realloc");
+    }
+    memcpy(pool + pool_len, name, len);
+    names[n_names++] = pool_len;
+    pool_len += len;
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+    return strcmp(pool + *(const uint32_t *) a, pool + *(const uint32_t *) b);
+}
+
+/* Add the executables of a directory to the index.
+ * @path: the directory
+ * @mtime: set to its modification time; zero if it can't be read */
+static void add_dir(const char *path, struct timespec *mtime)
+{
+    DIR *dp;
+    struct dirent *de;
+    struct stat st;
+
+    memset(mtime, 0, sizeof(*mtime));
+    if (!(dp = opendir(path)))
+	return;
+    if (!fstat(dirfd(dp), &st))
+	*mtime = st.st_mtim;
+    while ((de = readdir(dp))) {
+	if (de->d_name[0] == '.' || (de->d_type != DT_REG && de->d_type != DT_LNK
+		    && de->d_type != DT_UNKNOWN))
+	    continue;
+	if (!fstatat(dirfd(dp), de->d_name, &st, 0) && S_ISREG(st.st_mode)
+		&& (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+	    add_name(de->d_name);
+    }
+    closedir(dp);
+}
+
+/* Forget the index. */
+static void drop(void)
+{
+    int i;
+
+    for (i = 0; i < n_dirs; i++)
+	free(dirs[i].path);
+    free(dirs);
+    dirs = (INDEXED_DIR *) NULL;
+    n_dirs = 0;
+    pool_len = 0;
+    n_names = 0;
+    valid = 0;
+}
+
+/* Build the index: builtins and executables, sorted, each once. */
+static void build(void)
+{
+    struct Node *itr;
+    uint32_t i, j;
+    int k;
+
+    drop();
+    for (k = 0; builtins[k].name; k++)
+	add_name(builtins[k].name);
+
+    if (!(dirs = (INDEXED_DIR *) malloc((list_size(&paths_list) + 1) * sizeof(INDEXED_DIR))))
+	die_with_error("malloc");
+    for (itr = paths_list.front; itr && itr != paths_list.tail; itr = itr->next) {
+	dirs[n_dirs].path = dupstr((char *) itr->data);
+	add_dir(dirs[n_dirs].path, &dirs[n_dirs].mtime);
+	n_dirs++;
+    }
+
+    /* sort, then drop the names found in more than one place */
+    qsort(names, n_names, sizeof(uint32_t), name_cmp);
+    for (i = j = 0; i < n_names; i++)
+	if (!j || strcmp(pool + names[i], pool + names[j-1]))
+	    names[j++] = names[i];
+    n_names = j;
+    valid = 1;
+}
+
+/* Is the index stale? It is if it was invalidated, if paths_list
+ * differs from its directories or if one of them was modified.
+ * @return: non-zero if so */
+static int stale(void)
+{
+    struct Node *itr;
+    struct stat st;
+    struct timespec mtime;
+    int k = 0;
+
+    if (!valid)
+	return 1;
+    for (itr = paths_list.front; itr && itr != paths_list.tail; itr = itr->next, k++) {
+	if (k == n_dirs || strcmp(dirs[k].path, (char *) itr->data))
+	    return 1;
+	memset(&mtime, 0, sizeof(mtime));
+	if (!stat(dirs[k].path, &st))
+	    mtime = st.st_mtim;
+	if (mtime.tv_sec != dirs[k].mtime.tv_sec || mtime.tv_nsec != dirs[k].mtime.tv_nsec)
+	    return 1;
+    }
+    return k != n_dirs;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	  Completion Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Find the command names starting with a prefix, rebuilding the
+ * index first if it is stale.
+ * @prefix: the prefix
+ * @first: set to the position of the first name found
+ * @return: # of names found, at positions first, first + 1, ... */
+uint32_t complete_find(const char *prefix, uint32_t *first)
+{
+    size_t len = strlen(prefix);
+    uint32_t lo = 0, hi, mid, end;
+
+    if (stale())
+	build();
+
+    /* first name not less than prefix */
+    for (hi = n_names; lo < hi; ) {
+	mid = lo + (hi - lo) / 2;
+	if (strcmp(pool + names[mid], prefix) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    for (end = lo; end < n_names && !strncmp(pool + names[end], prefix, len); end++)
+	;
+    *first = lo;
+    return end - lo;
+}
+
+/* Get a command name of the index.
+ * @i: its position, as given by complete_find()
+ * @return: the name; valid until the index is rebuilt */
+const char *complete_name(uint32_t i)
+{
+    return pool + names[i];
+}
+
+/* Invalidate the index, e.g. after paths_list changed. */
+void complete_invalidate(void)
+{
+    valid = 0;
+}
+
+/* Release memory of the index. */
+void complete_clean(void)
+{
+    drop();
+    free(pool);
+    free(names);
+    pool = (char *) NULL;
+    names = (uint32_t *) NULL;
+    pool_cap = names_cap = 0;
+}
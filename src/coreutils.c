@@ -0,0 +1,1212 @@
+/**
+ * This file implements the utility fast paths of Hank Shell: true,
+ * false, test/[, printf, cat, basename and dirname run inside hsh,
+ * with the semantics of their coreutils counterparts, instead of
+ * being found in the path list, spawned and waited for. Scripts
+ * spend most of their time on such tiny commands.
+ *
+ * A command prefixed with 'command', e.g. 'command cat', bypasses
+ * the fast path and runs the utility found in the path list.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include <inttypes.h>
+#include <sys/sendfile.h>
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define CAT_BUF_SIZE 131072	/* size of a single read() of cat */
+#define CAT_MOVE_SIZE (1 << 30)	/* max size of a single in-kernel move */
+
+/* in-kernel movers of cat, see cat_copy() */
+#define CAT_COPY_RANGE	1
+#define CAT_SPLICE	2
+#define CAT_SENDFILE	3
+
+/* the expression test is evaluating */
+static char **test_argv;
+static int test_argc, test_pos;
+static const char *test_name;	/* "test" or "[" */
+static int test_failed;		/* a syntax error was reported */
+
+static int printf_failed;	/* an argument was not a valid number */
+static volatile sig_atomic_t cat_interrupted = 0;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    test Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+static int test_or(void);
+
+/* Report a syntax error of test once.
+ * @return: 0, the value of the failed expression */
+static int test_error(const char *fmt, const char *arg)
+{
+    if (!test_failed) {
+	fprintf(stderr, "-hsh: %s: ", test_name);
+	fprintf(stderr, fmt, arg);
+	fputc('\n', stderr);
+    }
+    test_failed = 1;
+    return 0;
+}
+
+/* Check an integer operand the way coreutils does: blanks around
+ * an optional sign and decimal digits, of any length.
+ * @s: the operand
+ * @pdigits: set to its digits, without leading zeros
+ * @plen: set to # of those digits
+ * @return: -1 or 1, its sign; 0 if it is not an integer */
+static int test_integer(const char *s, const char **pdigits, size_t *plen)
+{
+    const char *p = s;
+    int sign = 1;
+
+    while (isblank((unsigned char) *p))
+	p++;
+    if (*p == '-' || *p == '+')
+	sign = (*p++ == '-') ? -1 : 1;
+    if (!isdigit((unsigned char) *p)) {
+	test_error("invalid integer '%s'", s);
+	return 0;
+    }
+    while (*p == '0' && isdigit((unsigned char) p[1]))
+	p++;
+    *pdigits = p;
+    while (isdigit((unsigned char) *p))
+	p++;
+    *plen = p - *pdigits;
+    while (isblank((unsigned char) *p))
+	p++;
+    if (*p) {
+	test_error("invalid integer '%s'", s);
+	return 0;
+    }
+    if (*plen == 1 && **pdigits == '0')
+	sign = 1;			/* -0 is 0 */
+    return sign;
+}
+
+/* Compare two integer operands, however long.
+ * @return: <0, 0 or >0 as a is less, equal or greater than b; 
+ * 	    0 if one is not an integer */
+static int test_compare(const char *a, const char *b)
+{
+    const char *da, *db;
+    size_t la, lb;
+    int sa, sb, cmp;
+
+    if (!(sa = test_integer(a, &da, &la)) || !(sb = test_integer(b, &db, &lb)))
+	return 0;
+    if (sa != sb)
+	return sa;
+    cmp = (la != lb) ? (la < lb ? -1 : 1) : memcmp(da, db, la);
+    return sa * cmp;
+}
+
+/* Is a word a binary operator of test? */
+static int test_is_binop(const char *op)
+{
+    static const char *ops[] = { "=", "==", "!=", "-eq", "-ne", "-lt",
+	"-le", "-gt", "-ge", "-nt", "-ot", "-ef", (char *) NULL };
+    int i;
+
+    for (i = 0; ops[i]; i++)
+	if (!strcmp(op, ops[i]))
+	    return 1;
+    return 0;
+}
+
+/* Is a word an integer comparison of test, which takes '-l STRING',
+ * the length of STRING, for an operand? */
+static int test_is_intop(const char *op)
+{
+    return op[0] == '-' && strcmp(op, "-nt") && strcmp(op, "-ot") && strcmp(op, "-ef")
+	&& test_is_binop(op);
+}
+
+/* Is a word a unary operator of test? */
+static int test_is_unop(const char *op)
+{
+    return op[0] == '-' && op[1] && !op[2] && strchr("bcdefghkLnOprsStuwxzGN", op[1]);
+}
+
+/* Modification time of a file for -nt and -ot.
+ * @return: 0 if it exists otherwise -1 */
+static int test_mtime(const char *path, struct timespec *ts)
+{
+    struct stat st;
+
+    if (stat(path, &st))
+	return -1;
+    *ts = st.st_mtim;
+    return 0;
+}
+
+/* Evaluate 'a op b'. */
+static int test_binary(const char *a, const char *op, const char *b)
+{
+    int cmp;
+    struct stat sa, sb;
+    struct timespec ta = { 0, 0 }, tb = { 0, 0 };
+    int ea, eb;
+
+    if (!strcmp(op, "=") || !strcmp(op, "=="))
+	return !strcmp(a, b);
+    if (!strcmp(op, "!="))
+	return strcmp(a, b) != 0;
+    if (!strcmp(op, "-nt") || !strcmp(op, "-ot")) {
+	ea = test_mtime(a, &ta);
+	eb = test_mtime(b, &tb);
+	if (op[1] == 'o') {	/* a -ot b is b -nt a */
+	    struct timespec t = ta;
+	    int e = ea;
+	    ta = tb, ea = eb;
+	    tb = t, eb = e;
+	}
+	if (ea || eb)
+	    return !ea && eb;
+	return ta.tv_sec > tb.tv_sec || (ta.tv_sec == tb.tv_sec && ta.tv_nsec > tb.tv_nsec);
+    }
+    if (!strcmp(op, "-ef"))
+	return !stat(a, &sa) && !stat(b, &sb) && sa.st_dev == sb.st_dev
+	    && sa.st_ino == sb.st_ino;
+
+    cmp = test_compare(a, b);
+    switch (op[1] << 8 | op[2]) {
+	case 'e' << 8 | 'q': return cmp == 0;
+	case 'n' << 8 | 'e': return cmp != 0;
+	case 'l' << 8 | 't': return cmp < 0;
+	case 'l' << 8 | 'e': return cmp <= 0;
+	case 'g' << 8 | 't': return cmp > 0;
+	default:	     return cmp >= 0;
+    }
+}
+
+/* Evaluate '-op arg'. */
+static int test_unary(char op, const char *arg)
+{
+    struct stat st;
+    const char *digits;
+    size_t len;
+
+    switch (op) {
+	case 'n': return *arg != '\0';
+	case 'z': return *arg == '\0';
+	case 'r': return !access(arg, R_OK);
+	case 'w': return !access(arg, W_OK);
+	case 'x': return !access(arg, X_OK);
+	case 't': return test_integer(arg, &digits, &len) == 1 && len < 10
+		  && isatty(atoi(digits));
+	case 'h':
+	case 'L': return !lstat(arg, &st) && S_ISLNK(st.st_mode);
+    }
+    if (stat(arg, &st))
+	return 0;
+    switch (op) {
+	case 'b': return S_ISBLK(st.st_mode);
+	case 'c': return S_ISCHR(st.st_mode);
+	case 'd': return S_ISDIR(st.st_mode);
+	case 'f': return S_ISREG(st.st_mode);
+	case 'p': return S_ISFIFO(st.st_mode);
+	case 'S': return S_ISSOCK(st.st_mode);
+	case 'g': return (st.st_mode & S_ISGID) != 0;
+	case 'u': return (st.st_mode & S_ISUID) != 0;
+	case 'k': return (st.st_mode & S_ISVTX) != 0;
+	case 's': return st.st_size > 0;
+	case 'O': return st.st_uid == geteuid();
+	case 'G': return st.st_gid == getegid();
+	case 'N': return st.st_mtim.tv_sec > st.st_atim.tv_sec
+		  || (st.st_mtim.tv_sec == st.st_atim.tv_sec
+			  && st.st_mtim.tv_nsec > st.st_atim.tv_nsec);
+	default:  return 1;	/* 'e' */
+    }
+}
+
+/* term: '!' term | '(' expr ')' | -op arg | arg op arg | arg, where
+ * an operand of an integer comparison may be '-l STRING' */
+static int test_term(void)
+{
+    int value;
+    char **argv = test_argv + test_pos, la[24], lb[24];
+    const char *a, *b;
+    int left = test_argc - test_pos;
+
+    if (left <= 0)
+	return test_error("%s", "argument expected");
+    if (!strcmp(argv[0], "!")) {
+	test_pos++;
+	return !test_term();
+    }
+    if (!strcmp(argv[0], "(")) {
+	test_pos++;
+	value = test_or();
+	if (test_pos >= test_argc || strcmp(test_argv[test_pos], ")"))
+	    return test_error("%s", "')' expected");
+	test_pos++;
+	return value;
+    }
+    a = argv[0];
+    if (left >= 4 && !strcmp(argv[0], "-l") && test_is_binop(argv[2])) {
+	snprintf(la, sizeof(la), "%zu", strlen(argv[1]));
+	a = test_is_intop(argv[2]) ? la : argv[1];	/* as coreutils */
+	argv++, left--, test_pos++;
+    }
+    if (left >= 3 && test_is_binop(argv[1])) {
+	b = argv[2];
+	if (left >= 4 && test_is_intop(argv[1]) && !strcmp(b, "-l")) {
+	    snprintf(lb, sizeof(lb), "%zu", strlen(argv[3]));
+	    b = lb;
+	    test_pos++;
+	}
+	test_pos += 3;
+	return test_binary(a, argv[1], b);
+    }
+    if (test_is_unop(argv[0])) {
+	if (left < 2)
+	    return test_error("'%s': argument expected", argv[0]);
+	test_pos += 2;
+	return test_unary(argv[0][1], argv[1]);
+    }
+    test_pos++;
+    return *argv[0] != '\0';
+}
+
+/* and: term ['-a' and] */
+static int test_and(void)
+{
+    int value = test_term();
+
+    while (test_pos < test_argc && !strcmp(test_argv[test_pos], "-a")) {
+	test_pos++;
+	value = test_term() && value;
+    }
+    return value;
+}
+
+/* or: and ['-o' or] */
+static int test_or(void)
+{
+    int value = test_and();
+
+    while (test_pos < test_argc && !strcmp(test_argv[test_pos], "-o")) {
+	test_pos++;
+	value = test_and() || value;
+    }
+    return value;
+}
+
+/* Evaluate n arguments as POSIX does for n <= 4, where the number
+ * of arguments decides what they mean; a full expression otherwise.
+ * @argv: the arguments
+ * @n: # of them */
+static int test_posix(char **argv, int n)
+{
+    switch (n) {
+	case 0:
+	    return 0;
+	case 1:
+	    return *argv[0] != '\0';
+	case 2:
+	    if (!strcmp(argv[0], "!"))
+		return !test_posix(argv + 1, 1);
+	    if (test_is_unop(argv[0]))
+		return test_unary(argv[0][1], argv[1]);
+	    return test_error("'%s': unary operator expected", argv[0]);
+	case 3:
+	    if (test_is_binop(argv[1]))
+		return test_binary(argv[0], argv[1], argv[2]);
+	    if (!strcmp(argv[0], "!"))
+		return !test_posix(argv + 1, 2);
+	    if (!strcmp(argv[0], "(") && !strcmp(argv[2], ")"))
+		return test_posix(argv + 1, 1);
+	    if (strcmp(argv[1], "-a") && strcmp(argv[1], "-o"))
+		return test_error("'%s': binary operator expected", argv[1]);
+	    break;
+	case 4:
+	    if (!strcmp(argv[0], "!"))
+		return !test_posix(argv + 1, 3);
+	    if (!strcmp(argv[0], "(") && !strcmp(argv[3], ")"))
+		return test_posix(argv + 1, 2);
+	    break;
+    }
+
+    test_argv = argv;
+    test_argc = n;
+    test_pos = 0;
+    n = test_or();
+    if (test_pos < test_argc)
+	test_error("'%s': extra argument", test_argv[test_pos]);
+    return n;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	   printf Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Value of a hexadecimal digit. */
+static int hex_digit(char c)
+{
+    return isdigit((unsigned char) c) ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+/* Whether characters are to be printed in UTF-8, as the locale
+ * named by LC_ALL, LC_CTYPE or LANG, the first one set, says. */
+static int utf8_locale(void)
+{
+    const char *names[] = { "LC_ALL", "LC_CTYPE", "LANG" }, *s;
+    int k;
+
+    for (k = 0; k < 3; k++) {
+	if ((s = getenv(names[k])) && *s) {
+	    for (; *s; s++)
+		if (!strncasecmp(s, "utf-8", 5) || !strncasecmp(s, "utf8", 4))
+		    return 1;
+	    return 0;
+	}
+    }
+    return 0;
+}
+
+/* Report a '\x', '\u' or '\U' without enough hexadecimal digits;
+ * like coreutils, this ends all output.
+ * @p: the character after the sequence
+ * @stop: set
+ * @return: p */
+static const char *escape_error(const char *p, int *stop)
+{
+    fprintf(stderr, "-hsh: printf: missing hexadecimal number in escape\n");
+    printf_failed = *stop = 1;
+    return p;
+}
+
+/* Print a universal character name, '\uHHHH' or '\UHHHHHHHH'. It is
+ * printed in UTF-8 if the locale is a UTF-8 one; otherwise, as
+ * coreutils does, as the escape again.
+ * @p: the 'u' or 'U'
+ * @stop: set on error, which ends all output
+ * @return: the character after the sequence */
+static const char *print_unicode(const char *p, int *stop)
+{
+    char esc = *p++;
+    int n, len = (esc == 'u') ? 4 : 8;
+    unsigned long c = 0;
+
+    for (n = 0; n < len; n++, p++) {
+	if (!isxdigit((unsigned char) *p))
+	    return escape_error(p, stop);
+	c = c * 16 + hex_digit(*p);
+    }
+    if ((c < 0xa0 && c != '$' && c != '@' && c != '`') || (c >= 0xd800 && c <= 0xdfff)) {
+	fprintf(stderr, "-hsh: printf: invalid universal character name \\%c%0*lx\n",
+		esc, len, c);
+	printf_failed = *stop = 1;
+	return p;
+    }
+
+    if (c < 0x80)
+	putchar(c);
+    else if (!utf8_locale() || c > 0x10ffff)
+	printf(c < 0x10000 ? "\\u%04lX" : "\\U%08lX", c);
+    else if (c < 0x800)
+	printf("%c%c", (int) (0xc0 | c >> 6), (int) (0x80 | (c & 0x3f)));
+    else if (c < 0x10000)
+	printf("%c%c%c", (int) (0xe0 | c >> 12), (int) (0x80 | (c >> 6 & 0x3f)),
+		(int) (0x80 | (c & 0x3f)));
+    else
+	printf("%c%c%c%c", (int) (0xf0 | c >> 18), (int) (0x80 | (c >> 12 & 0x3f)),
+		(int) (0x80 | (c >> 6 & 0x3f)), (int) (0x80 | (c & 0x3f)));
+    return p;
+}
+
+/* Print the escape sequence at a backslash.
+ * @p: the character after the backslash
+ * @in_b: non-zero for an argument of %b, where octal is '\0NNN'
+ * @stop: set if the sequence is '\c', which ends all output
+ * @return: the character after the sequence */
+static const char *print_escape(const char *p, int in_b, int *stop)
+{
+    int n, c = 0;
+
+    switch (*p) {
+	case 'a':  putchar('\a'); return p + 1;
+	case 'b':  putchar('\b'); return p + 1;
+	case 'e':  putchar('\033'); return p + 1;
+	case 'f':  putchar('\f'); return p + 1;
+	case 'n':  putchar('\n'); return p + 1;
+	case 'r':  putchar('\r'); return p + 1;
+	case 't':  putchar('\t'); return p + 1;
+	case 'v':  putchar('\v'); return p + 1;
+	case '\\': putchar('\\'); return p + 1;
+	case '"':  putchar('"'); return p + 1;
+	case 'c':  *stop = 1; return p + 1;
+	case 'x':
+	    for (n = 0, p++; n < 2 && isxdigit((unsigned char) *p); n++, p++)
+		c = c * 16 + hex_digit(*p);
+	    if (!n)
+		return escape_error(p, stop);
+	    putchar(c);
+	    return p;
+	case 'u':
+	case 'U':
+	    return print_unicode(p, stop);
+    }
+    if (*p >= '0' && *p <= '7') {
+	if (in_b && *p == '0')
+	    p++;
+	for (n = 0; n < 3 && *p >= '0' && *p <= '7'; n++, p++)
+	    c = c * 8 + *p - '0';
+	putchar(c);
+	return p;
+    }
+    putchar('\\');		/* not an escape: kept as is */
+    return p;
+}
+
+/* Convert a numeric argument of printf. 'c or "c is the code of c.
+ * Errors are reported and leave what could be converted.
+ * @arg: the argument
+ * @conv: the conversion character */
+static intmax_t printf_int(const char *arg, char conv)
+{
+    char *end;
+    intmax_t n;
+
+    if (*arg == '\'' || *arg == '"')
+	return (unsigned char) arg[1];
+    errno = 0;
+    n = (conv == 'd' || conv == 'i') ? strtoimax(arg, &end, 0)
+				     : (intmax_t) strtoumax(arg, &end, 0);
+    if (end == arg)
+	fprintf(stderr, "-hsh: printf: '%s': expected a numeric value\n", arg);
+    else if (*end)
+	fprintf(stderr, "-hsh: printf: '%s': value not completely converted\n", arg);
+    else if (errno)
+	fprintf(stderr, "-hsh: printf: '%s': %s\n", arg, strerror(errno));
+    if (end == arg || *end || errno)
+	printf_failed = 1;
+    return n;
+}
+
+/* Convert a floating point argument of printf, like printf_int().
+ * @arg: the argument */
+static long double printf_float(const char *arg)
+{
+    char *end;
+    long double x;
+
+    if (*arg == '\'' || *arg == '"')
+	return (unsigned char) arg[1];
+    errno = 0;
+    x = strtold(arg, &end);
+    if (end == arg || *end) {
+	fprintf(stderr, "-hsh: printf: '%s': %s\n", arg, (end == arg) ?
+		"expected a numeric value" : "value not completely converted");
+	printf_failed = 1;
+    }
+    return x;
+}
+
+/* Print a %b argument.
+ * @return: non-zero if it held '\c' */
+static int print_b(const char *s)
+{
+    int stop = 0;
+
+    while (*s && !stop) {
+	if (*s == '\\' && s[1])
+	    s = print_escape(s + 1, 1, &stop);
+	else
+	    putchar(*s++);
+    }
+    return stop;
+}
+
+/* Whether a byte of a %q argument can be printed as is in quotes.
+ * Bytes outside ASCII are only in a UTF-8 locale, and then only as
+ * part of a well formed sequence.
+ * @s: the byte
+ * @utf8: whether the locale is a UTF-8 one
+ * @plen: set to # of bytes of the character
+ * @return: non-zero if printable */
+static int q_printable(const unsigned char *s, int utf8, int *plen)
+{
+    int k, len;
+
+    *plen = 1;
+    if (*s < 0x80)
+	return isprint(*s);
+    if (!utf8)
+	return 0;
+    len = (*s >= 0xf0 && *s < 0xf5) ? 4 : (*s >= 0xe0) ? 3 : (*s >= 0xc2) ? 2 : 0;
+    if (*s >= 0xf5 || !len)
+	return 0;
+    for (k = 1; k < len; k++)
+	if ((s[k] & 0xc0) != 0x80)
+	    return 0;
+    *plen = len;
+    return 1;
+}
+
+/* Print a %q argument quoted for reuse as shell input, the way
+ * coreutils does: as is if nothing in it is special; in double
+ * quotes if it has single quotes but nothing else that is special
+ * within double quotes; else in single quotes, with unprintable
+ * characters in $'...' escapes. Like coreutils, a quoted argument
+ * with a single quote and ending in an unprintable character starts
+ * as if an escape was open.
+ * @s: the argument */
+static void print_q(const char *s)
+{
+    const unsigned char *u = (const unsigned char *) s;
+    int utf8 = utf8_locale(), len, first, printable = 1;
+    int plain = 1, dquote = 1, squote = 0, escaping;
+    const char *esc;
+
+    if (!*s) {
+	fputs("''", stdout);
+	return;
+    }
+    for (; *u; u += len) {
+	first = (u == (const unsigned char *) s);
+	printable = q_printable(u, utf8, &len);
+	if (printable && (*u >= 0x80 || isalnum(*u) || strchr("%+,-./:@]_", *u)))
+	    continue;
+
+	/* '#' and '~' are special first, '{' and '}' on their own */
+	if ((*u == '{' || *u == '}') ? (first && !u[1]) : ((*u != '#' && *u != '~') || first))
+	    plain = 0;
+	if (printable && *u == '\'')
+	    squote = 1;
+	else if (!printable || !(*u == ' ' || ((*u == '#' || *u == '~') && first)))
+	    dquote = 0;
+    }
+    if (plain) {
+	fputs(s, stdout);
+	return;
+    }
+    if (dquote && squote) {
+	printf("\"%s\"", s);
+	return;
+    }
+
+    putchar('\'');
+    escaping = squote && !printable;
+    for (u = (const unsigned char *) s; *u; u += len) {
+	if (!q_printable(u, utf8, &len)) {
+	    if (!escaping)
+		fputs("'$'", stdout);
+	    escaping = 1;
+	    if ((esc = strchr("\aa\bb\ff\nn\rr\tt\vv", *u)))
+		printf("\\%c", esc[1]);
+	    else
+		printf("\\%03o", *u);
+	    continue;
+	}
+	if (*u == '\'') {
+	    fputs("'\\''", stdout);
+	} else {
+	    if (escaping)
+		fputs("''", stdout);
+	    fwrite(u, 1, len, stdout);
+	}
+	escaping = 0;
+    }
+    putchar('\'');
+}
+
+/* printf a conversion with its '*' width and precision, if any */
+#define PRINT_SPEC(spec, v) (n_star == 2 ? printf(spec, star[0], star[1], v) \
+	: n_star == 1 ? printf(spec, star[0], v) : printf(spec, v))
+
+/* Print the format once, consuming arguments.
+ * @fmt: the format
+ * @pargv: arguments left; advanced past those consumed
+ * @stop: set if the output was ended by '\c'
+ * @return: 0 if no errors otherwise -1 */
+static int print_format(const char *fmt, char ***pargv, int *stop)
+{
+    char spec[64], *d, conv;
+    const char *p = fmt, *start, *arg;
+    int star[2], n_star;
+    char **argv = *pargv;
+
+    while (*p && !*stop) {
+	if (*p == '\\') {
+	    p = print_escape(p + 1, 0, stop);
+	    continue;
+	}
+	if (*p != '%') {
+	    putchar(*p++);
+	    continue;
+	}
+	if (p[1] == '%') {
+	    putchar('%');
+	    p += 2;
+	    continue;
+	}
+
+	/* a conversion: %[flags][width][.precision][length]conv */
+	start = p;
+	d = spec;
+	*d++ = *p++;
+	n_star = 0;
+	while (*p && strchr("-+ #0'", *p) && d < spec + 16)
+	    *d++ = *p++;
+	if (*p == '*') {
+	    *d++ = *p++;
+	    star[n_star++] = *argv ? (int) printf_int(*argv++, 'd') : 0;
+	}
+	while (isdigit((unsigned char) *p) && d < spec + 32)
+	    *d++ = *p++;
+	if (*p == '.') {
+	    *d++ = *p++;
+	    if (*p == '*') {
+		*d++ = *p++;
+		star[n_star++] = *argv ? (int) printf_int(*argv++, 'd') : 0;
+	    }
+	    while (isdigit((unsigned char) *p) && d < spec + 48)
+		*d++ = *p++;
+	}
+	while (*p && strchr("hlLjzt", *p))
+	    p++;
+	if (!*p || !strchr("diouxXeEfFgGaAcsbq", *p) || (*p == 'q' && d != spec + 1)) {
+	    fprintf(stderr, "-hsh: printf: '%.*s': invalid conversion specification\n",
+		    (int) (p - start) + (*p != '\0'), start);
+	    return -1;
+	}
+	conv = *p++;
+	arg = *argv ? *argv++ : "";
+
+	if (conv == 'b') {
+	    *stop = print_b(arg);
+	} else if (conv == 'q') {
+	    print_q(arg);
+	} else if (strchr("diouxX", conv)) {
+	    *d++ = 'j';
+	    *d++ = conv;
+	    *d = '\0';
+	    PRINT_SPEC(spec, *arg ? printf_int(arg, conv) : (intmax_t) 0);
+	} else if (strchr("eEfFgGaA", conv)) {
+	    *d++ = 'L';
+	    *d++ = conv;
+	    *d = '\0';
+	    PRINT_SPEC(spec, *arg ? printf_float(arg) : (long double) 0);
+	} else {
+	    *d++ = conv;
+	    *d = '\0';
+	    if (conv == 'c')
+		PRINT_SPEC(spec, *arg);
+	    else
+		PRINT_SPEC(spec, arg);
+	}
+    }
+
+    *pargv = argv;
+    return 0;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    cat Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* options of cat which make it look at every character */
+#define CAT_NUMBER	1	/* -n: number lines */
+#define CAT_NONBLANK	2	/* -b: number nonempty lines */
+#define CAT_SQUEEZE	4	/* -s: squeeze repeated empty lines */
+#define CAT_ENDS	8	/* -E: '$' at end of lines */
+#define CAT_TABS	16	/* -T: tabs as ^I */
+#define CAT_NONPRINT	32	/* -v: ^ and M- notation */
+
+/* state of a formatted cat carried from a file to the next */
+typedef struct {
+    long line;		/* # of the last line numbered */
+    int bol;		/* at the beginning of a line */
+    int empty;		/* # of empty lines in a row */
+} CAT_STATE;
+
+static void cat_sigint(int sig)
+{
+    cat_interrupted = 1;
+}
+
+/* Write a buffer to stdout entirely.
+ * @return: 0 if no errors otherwise -1 */
+static int write_all(const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len) {
+	if (-1 == (n = write(STDOUT_FILENO, buf, len))) {
+	    if (errno == EINTR && !cat_interrupted)
+		continue;
+	    return -1;
+	}
+	buf += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/* Copy an open file to stdout as it is, through a buffer.
+ * @fd: the file
+ * @buf: a buffer of CAT_BUF_SIZE bytes
+ * @return: 0 if no errors, 1 on a read error, -1 on a write error */
+static int cat_plain(int fd, char *buf)
+{
+    ssize_t n;
+
+    while (1) {
+	if (-1 == (n = read(fd, buf, CAT_BUF_SIZE))) {
+	    if (errno == EINTR && !cat_interrupted)
+		continue;
+	    return 1;
+	}
+	if (!n)
+	    return 0;
+	if (write_all(buf, n))
+	    return -1;
+    }
+}
+
+/* Move data from a file to stdout in the kernel, without copying
+ * it through cat's buffer.
+ * @fd: the file
+ * @how: CAT_COPY_RANGE, CAT_SPLICE or CAT_SENDFILE
+ * @return: 0 at end of file; -1 if the mover failed, in which case
+ * 	    the rest is left to cat_plain() */
+static int cat_move(int fd, int how)
+{
+    ssize_t n;
+
+    while (!cat_interrupted) {
+	if (how == CAT_COPY_RANGE)
+	    n = copy_file_range(fd, NULL, STDOUT_FILENO, NULL, CAT_MOVE_SIZE, 0);
+	else if (how == CAT_SPLICE)
+	    n = splice(fd, NULL, STDOUT_FILENO, NULL, CAT_MOVE_SIZE, SPLICE_F_MOVE);
+	else
+	    n = sendfile(STDOUT_FILENO, fd, NULL, CAT_MOVE_SIZE);
+	if (!n)
+	    return 0;
+	if (n == -1 && errno != EINTR)
+	    return -1;
+    }
+    return -1;
+}
+
+/* Copy an open file to stdout with the cheapest mover the types of
+ * the two allow: copy_file_range() between regular files, splice()
+ * if one is a pipe, sendfile() from a regular file to anything else
+ * (a socket, /dev/null), else read() and write(). A mover which is
+ * not supported (e.g. across file systems, or to a file opened for
+ * appending) gives up before moving anything and the next is tried;
+ * a file of size 0, like those of /proc, is always read.
+ * @fd: the file
+ * @buf: a buffer of CAT_BUF_SIZE bytes
+ * @return: 0 if no errors, 1 on a read error, -1 on a write error */
+static int cat_copy(int fd, char *buf)
+{
+    struct stat in, out;
+    int sized;
+
+    if (fstat(fd, &in) || fstat(STDOUT_FILENO, &out))
+	return cat_plain(fd, buf);
+    sized = S_ISREG(in.st_mode) && in.st_size > 0;
+
+    if (sized && S_ISREG(out.st_mode) && !cat_move(fd, CAT_COPY_RANGE))
+	return 0;
+    if ((S_ISFIFO(in.st_mode) || S_ISFIFO(out.st_mode)) && !cat_move(fd, CAT_SPLICE))
+	return 0;
+    if (sized && !cat_move(fd, CAT_SENDFILE))
+	return 0;
+    return cat_interrupted ? 0 : cat_plain(fd, buf);
+}
+
+/* Copy an open file to stdout, formatted by the options.
+ * @fd: the file
+ * @buf: a buffer of CAT_BUF_SIZE bytes
+ * @opts: CAT_* options
+ * @st: state carried over from the previous file
+ * @return: 0 if no errors, 1 on a read error, -1 on a write error */
+static int cat_format(int fd, char *buf, int opts, CAT_STATE *st)
+{
+    ssize_t n, i;
+    unsigned char c;
+
+    while (1) {
+	if (-1 == (n = read(fd, buf, CAT_BUF_SIZE))) {
+	    if (errno == EINTR && !cat_interrupted)
+		continue;
+	    return 1;
+	}
+	if (!n)
+	    return ferror(stdout) ? -1 : 0;
+
+	for (i = 0; i < n; i++) {
+	    c = buf[i];
+	    if (st->bol) {
+		if (c == '\n' && (opts & CAT_SQUEEZE) && ++st->empty > 1)
+		    continue;
+		if (c != '\n')
+		    st->empty = 0;
+		if ((opts & CAT_NONBLANK) ? c != '\n' : (opts & CAT_NUMBER))
+		    printf("%6ld\t", ++st->line);
+		st->bol = 0;
+	    }
+	    if (c == '\n') {
+		if (opts & CAT_ENDS)
+		    putchar('$');
+		putchar('\n');
+		st->bol = 1;
+	    } else if (c == '\t') {
+		fputs((opts & CAT_TABS) ? "^I" : "\t", stdout);
+	    } else if (!(opts & CAT_NONPRINT)) {
+		putchar(c);
+	    } else {
+		if (c >= 128) {
+		    fputs("M-", stdout);
+		    c -= 128;
+		}
+		if (c < 32)
+		    printf("^%c", c + 64);
+		else if (c == 127)
+		    fputs("^?", stdout);
+		else
+		    putchar(c);
+	    }
+	}
+    }
+}
+
+/* Parse the options of cat.
+ * @pargs: arguments after the name; advanced past the options
+ * @return: CAT_* options; -1 on an invalid option */
+static int cat_options(char ***pargs)
+{
+    char **args = *pargs, *p;
+    int opts = 0;
+
+    for (; *args && args[0][0] == '-' && args[0][1]; args++) {
+	if (!strcmp(*args, "--")) {
+	    args++;
+	    break;
+	}
+	for (p = *args + 1; *p; p++) {
+	    switch (*p) {
+		case 'A': opts |= CAT_NONPRINT | CAT_ENDS | CAT_TABS; break;
+		case 'b': opts |= CAT_NONBLANK; break;
+		case 'e': opts |= CAT_NONPRINT | CAT_ENDS; break;
+		case 'E': opts |= CAT_ENDS; break;
+		case 'n': opts |= CAT_NUMBER; break;
+		case 's': opts |= CAT_SQUEEZE; break;
+		case 't': opts |= CAT_NONPRINT | CAT_TABS; break;
+		case 'T': opts |= CAT_TABS; break;
+		case 'u': break;
+		case 'v': opts |= CAT_NONPRINT; break;
+		default:
+		    fprintf(stderr, "-hsh: cat: invalid option -- '%c'\n", *p);
+		    return -1;
+	    }
+	}
+    }
+    *pargs = args;
+    return opts;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    Utility Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* true builtin function: do nothing, successfully
+ * @return: 0 */
+int builtin_true(int nargs, char **args)
+{
+    return 0;
+}
+
+/* false builtin function: do nothing, unsuccessfully
+ * @return: 1 */
+int builtin_false(int nargs, char **args)
+{
+    return 1;
+}
+
+/* test and [ builtin function: evaluate a conditional expression
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 if it is true, 1 if false, 2 on error */
+int builtin_test(int nargs, char **args)
+{
+    int value;
+
+    test_name = args[0];
+    test_failed = 0;
+    if (!strcmp(args[0], "[")) {
+	if (strcmp(args[nargs-1], "]")) {
+	    fprintf(stderr, "-hsh: [: missing ']'\n");
+	    return 2;
+	}
+	nargs--;
+    }
+    value = test_posix(args + 1, nargs - 1);
+    return test_failed ? 2 : !value;
+}
+
+/* printf builtin function: format and print arguments; the format
+ * is reused as long as it consumes arguments
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 if no errors otherwise 1 */
+int builtin_printf(int nargs, char **args)
+{
+    char **argv = args + 2, **before;
+    int stop = 0;
+
+    if (nargs > 1 && !strcmp(args[1], "--"))
+	args++, argv++, nargs--;
+    if (nargs < 2) {
+	fprintf(stderr, "-hsh: printf: missing operand\n");
+	return 1;
+    }
+
+    printf_failed = 0;
+    do {
+	before = argv;
+	if (print_format(args[1], &argv, &stop))
+	    return 1;
+    } while (*argv && argv != before && !stop);
+    return printf_failed;
+}
+
+/* cat builtin function: concatenate files ('-' or none: stdin) to
+ * stdout; on a terminal ^C ends it with status 130
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 if no errors otherwise 1 */
+int builtin_cat(int nargs, char **args)
+{
+    static char *dash[] = { "-", (char *) NULL };
+    char **files = args + 1, *buf;
+    int fd, rel, status = 0, opts;
+    struct stat in, out;
+    struct sigaction sa, old;
+    CAT_STATE st = { 0, 1, 0 };
+
+    if (-1 == (opts = cat_options(&files)))
+	return 1;
+    if (!*files)
+	files = dash;
+    if (!(buf = (char *) malloc(CAT_BUF_SIZE)))
+	die_with_error("malloc");
+    fflush(stdout);
+    if (fstat(STDOUT_FILENO, &out))
+	out.st_ino = 0;
+
+    /* on a terminal ^C must end the copy, not hsh */
+    cat_interrupted = 0;
+    sigaction(SIGINT, NULL, &old);
+    if (jobs_control()) {
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = cat_sigint;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+    }
+
+    for (; *files && !cat_interrupted; files++) {
+	if (!strcmp(*files, "-"))
+	    fd = STDIN_FILENO;
+	else if (-1 == (fd = open(*files, O_RDONLY))) {
+	    fprintf(stderr, "-hsh: cat: %s: %s\n", *files, strerror(errno));
+	    status = 1;
+	    continue;
+	}
+
+	if (!fstat(fd, &in) && S_ISREG(in.st_mode) && in.st_ino == out.st_ino
+		&& in.st_dev == out.st_dev && lseek(fd, 0, SEEK_CUR) < in.st_size) {
+	    fprintf(stderr, "-hsh: cat: %s: input file is output file\n", *files);
+	    rel = 0;
+	    status = 1;
+	} else {
+	    rel = opts ? cat_format(fd, buf, opts, &st) : cat_copy(fd, buf);
+	}
+	if (rel == 1 && !cat_interrupted) {
+	    fprintf(stderr, "-hsh: cat: %s: %s\n", *files, strerror(errno));
+	    status = 1;
+	}
+	if (fd != STDIN_FILENO)
+	    close(fd);
+	if (rel == -1) {
+	    if (!cat_interrupted)
+		fprintf(stderr, "-hsh: cat: write error: %s\n", strerror(errno));
+	    status = 1;
+	    break;
+	}
+    }
+
+    fflush(stdout);
+    sigaction(SIGINT, &old, NULL);
+    free(buf);
+    return cat_interrupted ? 130 : status;
+}
+
+/* Print a result of basename or dirname.
+ * @s: the result
+ * @len: its length
+ * @zero: non-zero to end it with '\0' instead of a newline */
+static void print_name(const char *s, size_t len, int zero)
+{
+    fwrite(s, 1, len, stdout);
+    putchar(zero ? '\0' : '\n');
+}
+
+/* basename builtin function: strip the directory, and a suffix,
+ * from names; 'basename NAME [SUFFIX]' or 'basename -a [-s SUFFIX]
+ * [-z] NAME...', with the long options of coreutils as well
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 if no errors otherwise 1 */
+int builtin_basename(int nargs, char **args)
+{
+    char **names = args + 1, *name, *suffix = (char *) NULL, *p;
+    int all = 0, zero = 0;
+    size_t len, slen;
+
+    for (; *names && names[0][0] == '-' && names[0][1]; names++) {
+	if (!strcmp(*names, "--")) {
+	    names++;
+	    break;
+	}
+	if (names[0][1] == '-') {	/* long options */
+	    if (!strcmp(*names, "--multiple")) {
+		all = 1;
+	    } else if (!strcmp(*names, "--zero")) {
+		zero = 1;
+	    } else if (!strncmp(*names, "--suffix=", 9)) {
+		suffix = *names + 9;
+		all = 1;
+	    } else if (!strcmp(*names, "--suffix")) {
+		if (!(suffix = *++names)) {
+		    fprintf(stderr, "-hsh: basename: option '--suffix' requires an argument\n");
+		    return 1;
+		}
+		all = 1;
+	    } else {
+		fprintf(stderr, "-hsh: basename: unrecognized option '%s'\n", *names);
+		return 1;
+	    }
+	    continue;
+	}
+	for (p = *names + 1; *p; p++) {
+	    if (*p == 'a') {
+		all = 1;
+	    } else if (*p == 'z') {
+		zero = 1;
+	    } else if (*p == 's') {
+		if (!(suffix = p[1] ? p + 1 : *++names)) {
+		    fprintf(stderr, "-hsh: basename: option requires an argument -- 's'\n");
+		    return 1;
+		}
+		all = 1;
+		break;
+	    } else {
+		fprintf(stderr, "-hsh: basename: invalid option -- '%c'\n", *p);
+		return 1;
+	    }
+	}
+    }
+    if (!*names) {
+	fprintf(stderr, "-hsh: basename: missing operand\n");
+	return 1;
+    }
+    if (!all && names[1]) {
+	suffix = names[1];
+	if (names[2]) {
+	    fprintf(stderr, "-hsh: basename: extra operand '%s'\n", names[2]);
+	    return 1;
+	}
+	names[1] = (char *) NULL;
+    }
+
+    slen = suffix ? strlen(suffix) : 0;
+    for (; *names; names++) {
+	name = *names;
+	len = strlen(name);
+	while (len > 1 && name[len-1] == '/')
+	    len--;
+	if (len == 1 && *name == '/') {
+	    print_name(name, 1, zero);
+	    continue;
+	}
+	for (p = name + len; p > name && p[-1] != '/'; p--)
+	    ;
+	len -= p - name;
+	if (slen && slen < len && !memcmp(p + len - slen, suffix, slen))
+	    len -= slen;
+	print_name(p, len, zero);
+    }
+    return 0;
+}
+
+/* dirname builtin function: strip the last component from names;
+ * 'dirname [-z|--zero] NAME...'
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 if no errors otherwise 1 */
+int builtin_dirname(int nargs, char **args)
+{
+    char **names = args + 1, *name, *p;
+    int zero = 0;
+    size_t len;
+
+    for (; *names && names[0][0] == '-' && names[0][1]; names++) {
+	if (!strcmp(*names, "--")) {
+	    names++;
+	    break;
+	}
+	if (!strcmp(*names, "--zero")) {
+	    zero = 1;
+	    continue;
+	}
+	for (p = *names + 1; *p; p++) {
+	    if (*p != 'z') {
+		fprintf(stderr, "-hsh: dirname: invalid option -- '%c'\n", *p);
+		return 1;
+	    }
+	    zero = 1;
+	}
+    }
+    if (!*names) {
+	fprintf(stderr, "-hsh: dirname: missing operand\n");
+	return 1;
+    }
+
+    for (; *names; names++) {
+	name = *names;
+	len = strlen(name);
+	while (len > 1 && name[len-1] == '/')	/* trailing slashes */
+	    len--;
+	while (len && name[len-1] != '/')	/* last component */
+	    len--;
+	while (len > 1 && name[len-1] == '/')	/* slashes before it */
+	    len--;
+	if (!len)
+	    print_name(*name == '/' ? "/" : ".", 1, zero);
+	else
+	    print_name(name, len, zero);
+    }
+    return 0;
+}
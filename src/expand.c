@@ -0,0 +1,439 @@
+/**
+ * This file is the word expansion engine for Hank Shell.
+ * Each word of a process goes through, in a single left-to-right
+ * scan: tilde expansion, parameter expansion ($VAR, ${VAR}, $?, $$),
+ * command substitution ($(cmd), `cmd`), field splitting of unquoted
+ * expansions, pathname expansion (globbing) and quote removal.
+ * Words without special characters take a zero-copy fast path; the
+ * resulting argument list lives in the per-line arena.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* characters which make a word need expansion; a word starting
+ * with '~' needs it too */
+#define WORD_META "$`*?[\\'\""
+
+/* characters special to glob(3) */
+#define GLOB_META "*?[\\"
+
+/* field separators for unquoted expansions */
+#define IFS " \t\n"
+
+/* A growable string buffer; buffers are reused across words */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} STRBUF;
+
+static STRBUF val;	/* current field after quote removal */
+static STRBUF pat;	/* current field as a glob pattern */
+static STRBUF sub;	/* output of a command substitution */
+
+/* state of the current field */
+static int quoted;	/* a quoted part was seen: keep even if empty */
+static int globbing;	/* an unquoted glob character was seen */
+
+/* the expanded argument list being built, in the arena */
+static char **argv_out;
+static int argc_out, argv_cap;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    Word Expansion Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Make room for n more bytes plus a null in a string buffer. */
+static void sb_reserve(STRBUF *sb, size_t n)
+{
+    if (sb->len + n + 1 <= sb->cap)
+	return;
+    sb->cap = (sb->len + n + 1) * 2;
+    if (!(sb->buf = (char *) realloc(sb->buf, sb->cap)))
+	die_with_error("realloc");
+}
+
+/* Append a character to a string buffer. */
+static void sb_putc(STRBUF *sb, char c)
+{
+    sb_reserve(sb, 1);
+    sb->buf[sb->len++] = c;
+}
+
+/* Append an argument to the expanded argument list, growing it
+ * inside the arena if needed. */
+static void push_arg(char *arg)
+{
+    char **grown;
+
+    if (argc_out == argv_cap) {
+	argv_cap *= 2;
+	grown = (char **) arena_alloc((argv_cap + 1) * sizeof(char *));
+	memcpy(grown, argv_out, argc_out * sizeof(char *));
+	argv_out = grown;
+    }
+    argv_out[argc_out++] = arg;
+}
+
+/* Add a character which must be taken literally. */
+static void put_quoted(char c)
+{
+    sb_putc(&val, c);
+    if (strchr(GLOB_META, c))
+	sb_putc(&pat, '\\');
+    sb_putc(&pat, c);
+}
+
+/* Add a character which is subject to globbing. */
+static void put_unquoted(char c)
+{
+    sb_putc(&val, c);
+    sb_putc(&pat, c);
+    if (strchr(GLOB_META, c))
+	globbing = 1;
+}
+
+/* Finish the current field: glob it if it has unquoted glob
+ * characters, then append the result to the argument list. */
+static void end_field(void)
+{
+    size_t i;
+    glob_t g;
+
+    if (!val.len && !quoted)
+	return;
+    sb_putc(&val, '\0');
+    sb_putc(&pat, '\0');
+
+    if (globbing && !glob(pat.buf, 0, NULL, &g)) {
+	for (i = 0; i < g.gl_pathc; i++)
+	    push_arg(arena_strdup(g.gl_pathv[i]));
+	globfree(&g);
+    } else {			/* no match: the word stays as it is */
+	push_arg(arena_strdup(val.buf));
+    }
+
+    val.len = pat.len = 0;
+    quoted = globbing = 0;
+}
+
+/* Add the result of an expansion to the current field. Unquoted
+ * results are split into fields on IFS characters.
+ * @s: the expanded text
+ * @n: length of s
+ * @in_quotes: non-zero if the expansion was double-quoted */
+static void put_expansion(const char *s, size_t n, int in_quotes)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+	if (in_quotes)
+	    put_quoted(s[i]);
+	else if (strchr(IFS, s[i]))
+	    end_field();
+	else
+	    put_unquoted(s[i]);
+    }
+}
+
+/* Run a command substitution in a forked copy of hsh and capture
+ * its standard output, without trailing newlines, in sub.
+ * @cmd: the command line; modified (terminated) in place */
+static void command_subst(char *cmd)
+{
+    int fds[2], status;
+    ssize_t n;
+    pid_t pid;
+
+    sub.len = 0;
+    if (-1 == pipe2(fds, O_CLOEXEC)) {
+	perror("pipe");
+	return;
+    }
+
+    if (-1 == (pid = fork())) {
+	perror("fork");
+	close(fds[0]);
+	close(fds[1]);
+	return;
+    } else if (!pid) {		/* child: run cmd with stdout to pipe */
+	job_child_setup((JOB *) NULL);
+	close(fds[0]);
+	if (dup2(fds[1], STDOUT_FILENO) == -1)
+	    _exit(EXIT_FAILURE);
+	close(fds[1]);
+	execute_cmdline(cmd);
+	fflush(stdout);
+	_exit(last_status);
+    }
+
+    close(fds[1]);
+    while (1) {
+	sb_reserve(&sub, 4096);
+	if (-1 == (n = read(fds[0], sub.buf + sub.len, sub.cap - sub.len - 1))) {
+	    if (errno == EINTR)
+		continue;
+	    break;
+	}
+	if (!n)
+	    break;
+	sub.len += n;
+    }
+    close(fds[0]);
+
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+	;
+    set_last_status(status);
+
+    while (sub.len && sub.buf[sub.len-1] == '\n')
+	sub.len--;
+}
+
+/* Expand a '$' construct.
+ * @p: the character after '$'
+ * @in_quotes: non-zero inside double quotes
+ * @return: the character after the construct */
+static char *expand_dollar(char *p, int in_quotes)
+{
+    char *end, *value, c, num[16];
+    int depth;
+
+    if (*p == '?' || *p == '$') {		/* special parameters */
+	snprintf(num, sizeof(num), "%d", (*p == '?') ? last_status : (int) getpid());
+	put_expansion(num, strlen(num), in_quotes);
+	return p + 1;
+    }
+
+    if (*p == '(') {				/* $(command) */
+	for (end = p + 1, depth = 1; *end; end++) {
+	    if (*end == '(')
+		depth++;
+	    else if (*end == ')' && !--depth)
+		break;
+	}
+	if (!*end) {			/* unbalanced: take it literally */
+	    put_quoted('$');
+	    return p;
+	}
+	c = *end;
+	*end = '\0';
+	command_subst(p + 1);
+	*end = c;
+	put_expansion(sub.buf, sub.len, in_quotes);
+	return end + 1;
+    }
+
+    if (*p == '{') {				/* ${name} */
+	if (!(end = strchr(p, '}'))) {
+	    put_quoted('$');
+	    return p;
+	}
+	*end = '\0';
+	if ((value = getenv(p + 1)))
+	    put_expansion(value, strlen(value), in_quotes);
+	*end = '}';
+	return end + 1;
+    }
+
+    if (*p != '_' && !isalpha((unsigned char) *p)) {	/* a lone '$' */
+	put_quoted('$');
+	return p;
+    }
+
+    for (end = p; *end == '_' || isalnum((unsigned char) *end); end++)
+	;
+    c = *end;				/* $name */
+    *end = '\0';
+    if ((value = getenv(p)))
+	put_expansion(value, strlen(value), in_quotes);
+    *end = c;
+    return end;
+}
+
+/* Expand a leading '~' or '~user'.
+ * @p: the character after '~'
+ * @return: the character after the user name; p if the tilde
+ * 	    is to be taken literally */
+static char *expand_tilde(char *p)
+{
+    char *end = p, *dir = (char *) NULL, c;
+    struct passwd *pw;
+
+    while (*end && *end != '/' && !strchr(WORD_META, *end))
+	end++;
+    if (*end && *end != '/') {		/* quoted user name */
+	put_quoted('~');
+	return p;
+    }
+
+    c = *end;
+    *end = '\0';
+    if (end == p && !(dir = getenv("HOME")) && (pw = getpwuid(getuid())))
+	dir = pw->pw_dir;
+    else if (end != p && (pw = getpwnam(p)))
+	dir = pw->pw_dir;
+    *end = c;
+
+    if (!dir) {				/* no such user */
+	put_quoted('~');
+	return p;
+    }
+    put_expansion(dir, strlen(dir), 1);
+    quoted = 1;
+    return end;
+}
+
+/* Expand a single word into fields appended to argv_out.
+ * @word: the word; restored to its original text on return */
+static void expand_word(char *word)
+{
+    char *p = word, *end;
+
+    if (*p == '~')
+	p = expand_tilde(p + 1);
+
+    while (*p) {
+	switch (*p) {
+	    case '\'':			/* literal up to closing quote */
+		quoted = 1;
+		for (p++; *p && *p != '\''; p++)
+		    put_quoted(*p);
+		if (*p)
+		    p++;
+		break;
+	    case '"':
+		quoted = 1;
+		for (p++; *p && *p != '"'; ) {
+		    if (*p == '\\' && p[1] && strchr("$`\"\\\n", p[1])) {
+			put_quoted(p[1]);
+			p += 2;
+		    } else if (*p == '$') {
+			p = expand_dollar(p + 1, 1);
+		    } else if (*p == '`' && (end = strchr(p + 1, '`'))) {
+			*end = '\0';
+			command_subst(p + 1);
+			*end = '`';
+			put_expansion(sub.buf, sub.len, 1);
+			p = end + 1;
+		    } else {
+			put_quoted(*p++);
+		    }
+		}
+		if (*p)
+		    p++;
+		break;
+	    case '\\':			/* escaped character */
+		if (p[1]) {
+		    put_quoted(p[1]);
+		    p += 2;
+		} else {
+		    p++;
+		}
+		break;
+	    case '$':
+		p = expand_dollar(p + 1, 0);
+		break;
+	    case '`':
+		/* an unmatched backquote is literal */
+		if ((end = strchr(p + 1, '`'))) {
+		    *end = '\0';
+		    command_subst(p + 1);
+		    *end = '`';
+		    put_expansion(sub.buf, sub.len, 0);
+		    p = end + 1;
+		    break;
+		}
+		/* fall through */
+	    default:
+		put_unquoted(*p++);
+		break;
+	}
+    }
+    end_field();
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Word Expansion Interface		     //
+// 	     	 						     //
+//===================================================================//
+
+/* A function to perform words expansion for a single process.
+ * Words needing no expansion are used as they are; the argument
+ * list and expanded words live in the per-line arena.
+ * @args: process argument list
+ * @pnargs: # of words after expansion
+ * @return: expanded argument list; NULL if errors occur */
+char **expand_words(char **args, int *pnargs)
+{
+    int i;
+
+    for (argv_cap = 0; args[argv_cap]; argv_cap++)
+	;
+    argv_out = (char **) arena_alloc((argv_cap + 1) * sizeof(char *));
+    argc_out = 0;
+
+    /* a command substitution child starts in the middle of a word */
+    val.len = pat.len = 0;
+    quoted = globbing = 0;
+
+    for (i = 0; args[i]; i++) {
+	if (args[i][0] != '~' && !strpbrk(args[i], WORD_META))
+	    push_arg(args[i]);		/* fast path: zero copy */
+	else
+	    expand_word(args[i]);
+    }
+
+    argv_out[argc_out] = (char *) NULL;
+    *pnargs = argc_out;
+    return argv_out;
+}
+
+/* Expand the file names of redirections; each must expand to
+ * exactly one word.
+ * @redirs: redirections of a process; paths are updated
+ * @n: # of redirections
+ * @return: 0 if no errors otherwise 1 */
+int expand_redirs(REDIR *redirs, int n)
+{
+    int i, nargs;
+    char *word[2] = { NULL, NULL }, **argv;
+
+    for (i = 0; i < n; i++) {
+	word[0] = redirs[i].path;
+	if (!word[0])			/* a duplication, '2>&1' */
+	    continue;
+	if (word[0][0] != '~' && !strpbrk(word[0], WORD_META))
+	    continue;
+	argv = expand_words(word, &nargs);
+	if (nargs != 1) {
+	    fprintf(stderr, "-hsh: %s: ambiguous redirect\n", redirs[i].path);
+	    return 1;
+	}
+	redirs[i].path = argv[0];
+    }
+    return 0;
+}
+
+/* Release memory of the word expansion engine. */
+void expand_clean(void)
+{
+    free(val.buf);
+    free(pat.buf);
+    free(sub.buf);
+    memset(&val, 0, sizeof(val));
+    memset(&pat, 0, sizeof(pat));
+    memset(&sub, 0, sizeof(sub));
+}
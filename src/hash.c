@@ -0,0 +1,210 @@
+/**
+ * This file implements the command hash table for Hank Shell.
+ * The table remembers the absolute pathname of every command
+ * found by find_cmd() so PATH is searched only once per name.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define HASH_INIT_BUCKETS 64	/* must be a power of 2 */
+
+/* A single entry in the command hash table */
+typedef struct hash_entry {
+    char *name;			/* command name, e.g. "ls" */
+    char *path;			/* resolved pathname, e.g. "/bin/ls" */
+    int hits;			/* # of times this entry was used */
+    struct hash_entry *next;	/* next entry in the same bucket */
+} HASH_ENTRY;
+
+static HASH_ENTRY **buckets = (HASH_ENTRY **) NULL;
+static unsigned int n_buckets = 0;
+static unsigned int n_entries = 0;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    Hash Table Helper Functions			     //
+// 	     	 						     //
+//===================================================================//
+
+/* FNV-1a string hash function.
+ * @s: the string to hash
+ * @return: hash value of s */
+static unsigned int hash_string(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s) {
+	h ^= (unsigned char) *s++;
+	h *= 16777619u;
+    }
+    return h;
+}
+
+/* Allocate an empty bucket array.
+ * @size: # of buckets; must be a power of 2
+ * @return: the bucket array */
+static HASH_ENTRY **alloc_buckets(unsigned int size)
+{
+    HASH_ENTRY **array = (HASH_ENTRY **) calloc(size, sizeof(HASH_ENTRY *));
+
+    if (!array)
+	die_with_error("calloc");
+    return array;
+}
+
+/* Double the # of buckets once the table gets crowded */
+static void hash_grow(void)
+{
+    unsigned int i, size = n_buckets << 1;
+    HASH_ENTRY **array = alloc_buckets(size);
+    HASH_ENTRY *entry, *next;
+
+    for (i = 0; i < n_buckets; i++) {
+	for (entry = buckets[i]; entry; entry = next) {
+	    next = entry->next;
+	    entry->next = array[hash_string(entry->name) & (size-1)];
+	    array[hash_string(entry->name) & (size-1)] = entry;
+	}
+    }
+
+    free(buckets);
+    buckets = array;
+    n_buckets = size;
+}
+
+/* Release memory of a single entry.
+ * @entry: the entry to be freed */
+static void free_entry(HASH_ENTRY *entry)
+{
+    free(entry->name);
+    free(entry->path);
+    free(entry);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Command Hash Table Interface		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Look up a command name in the hash table.
+ * @name: the command name
+ * @return: the hashed pathname; NULL if not hashed */
+char *hash_lookup(const char *name)
+{
+    HASH_ENTRY *entry;
+
+    if (!n_entries)
+	return (char *) NULL;
+
+    for (entry = buckets[hash_string(name) & (n_buckets-1)]; entry; entry = entry->next) {
+	if (!strcmp(entry->name, name)) {
+	    entry->hits++;
+	    return entry->path;
+	}
+    }
+    return (char *) NULL;
+}
+
+/* Insert (or replace) a command into the hash table.
+ * @name: the command name
+ * @path: the absolute pathname of that command
+ * @return: the pathname stored in the table */
+char *hash_insert(const char *name, const char *path)
+{
+    unsigned int idx;
+    HASH_ENTRY *entry;
+
+    if (!buckets) {
+	n_buckets = HASH_INIT_BUCKETS;
+	buckets = alloc_buckets(n_buckets);
+    }
+
+    idx = hash_string(name) & (n_buckets-1);
+    for (entry = buckets[idx]; entry; entry = entry->next) {
+	if (!strcmp(entry->name, name)) {
+	    free(entry->path);
+	    entry->path = dupstr((char *) path);
+	    return entry->path;
+	}
+    }
+
+    if (!(entry = (HASH_ENTRY *) malloc(sizeof(HASH_ENTRY))))
+	die_with_error("malloc");
+    entry->name = dupstr((char *) name);
+    entry->path = dupstr((char *) path);
+    entry->hits = 0;
+    entry->next = buckets[idx];
+    buckets[idx] = entry;
+
+    if (++n_entries > (n_buckets << 1))
+	hash_grow();
+    return entry->path;
+}
+
+/* Remove a command from the hash table, e.g. once its hashed
+ * pathname is no longer executable.
+ * @name: the command name */
+void hash_remove(const char *name)
+{
+    HASH_ENTRY **link, *entry;
+
+    if (!n_entries)
+	return;
+
+    for (link = &buckets[hash_string(name) & (n_buckets-1)]; (entry = *link); link = &entry->next) {
+	if (!strcmp(entry->name, name)) {
+	    *link = entry->next;
+	    free_entry(entry);
+	    n_entries--;
+	    return;
+	}
+    }
+}
+
+/* Remove every entry from the hash table. Called whenever
+ * the command search path list changes. */
+void hash_clear(void)
+{
+    unsigned int i;
+    HASH_ENTRY *entry, *next;
+
+    for (i = 0; i < n_buckets; i++) {
+	for (entry = buckets[i]; entry; entry = next) {
+	    next = entry->next;
+	    free_entry(entry);
+	}
+    }
+
+    free(buckets);
+    buckets = (HASH_ENTRY **) NULL;
+    n_buckets = n_entries = 0;
+}
+
+/* Return the # of commands in the hash table. */
+int hash_size(void)
+{
+    return n_entries;
+}
+
+/* Apply function f to every entry in the hash table.
+ * @f: function taking # of hits, command name and pathname
+ * @return: # of entries visited */
+int hash_traversal(void (*f)(int hits, const char *name, const char *path))
+{
+    unsigned int i;
+    HASH_ENTRY *entry;
+
+    for (i = 0; i < n_buckets; i++)
+	for (entry = buckets[i]; entry; entry = entry->next)
+	    f(entry->hits, entry->name, entry->path);
+    return n_entries;
+}
@@ -0,0 +1,683 @@
+/**
+ * This file implements the persistent command history of Hank Shell.
+ *
+ * The history file ($HISTFILE, or ~/.hsh_history) is append-only and
+ * mapped in memory rather than read line by line. After an 8 byte
+ * magic it holds one record per command line, a multiple of 8 bytes:
+ *
+ * 	uint32_t len	length of the line
+ * 	uint32_t sum	checksum of len and the padded line
+ * 	char line[len]	the line, then '\0' and zero padding
+ *
+ * A record which fails validation (e.g. torn by a crash) is skipped
+ * by looking for the next valid record at the following bytes. At
+ * most HISTSIZE (default HIST_SIZE) entries are kept: when twice as
+ * many are in the file, it is compacted into a new one.
+ *
+ * Many instances of hsh may share the file without any lock. Each
+ * appends a record in a single write to a file opened with O_APPEND,
+ * which lands whole at the end of it, and picks up the records of
+ * the others with hist_sync(), from the offset its last scan stopped
+ * at. Compaction writes a new file and renames it into place; only
+ * one instance at a time compacts, the one which created the claim
+ * file <file>.compact. The compacting instance copies to the new file
+ * the records appended to the old one meanwhile; an instance which
+ * finds its file replaced after a write writes its record again to
+ * the new one. A record is thus never lost, if rarely duplicated.
+ *
+ * Indexes, all kept as entry numbers rather than pointers since the
+ * map moves when the file grows:
+ * 	offsets	  offset of every record, built when the file is mapped;
+ * 		  'history N' prints straight from the map
+ * 	sorted	  entries sorted by line, built on the first prefix
+ * 		  search; later entries are merged in by batches
+ * 	trigrams  for every hashed trigram the entries containing it,
+ * 		  built on the first substring search
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include <sys/mman.h>
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define HIST_MAGIC	"HSHHIST\1"
+#define HIST_MAGIC_LEN	8
+#define HIST_SIZE	100000		/* default max # of entries kept */
+#define HIST_LINE_MAX	(1 << 20)	/* longer lines are not saved */
+#define HIST_TAIL_MAX	4096		/* unsorted entries before a merge */
+#define TRI_BITS	16		/* trigram hash buckets: 2^TRI_BITS */
+#define CLAIM_STALE	60		/* seconds a compaction claim lasts */
+
+/* header of a record */
+typedef struct {
+    uint32_t len;
+    uint32_t sum;
+} RECORD;
+
+/* entries containing a trigram (or a trigram of the same hash) */
+typedef struct {
+    uint32_t *ids;
+    uint32_t n, cap;
+} POSTINGS;
+
+static int hist_fd = -1;		/* -1: not opened yet */
+static int hist_failed = 0;		/* the file is unusable */
+static char *hist_path = (char *) NULL;
+static char *map = (char *) NULL;	/* the file, mapped */
+static size_t map_len = 0;
+static size_t scanned = 0;		/* offset the scan stopped at */
+static int pending = 0;			/* appended since the last sync */
+static uint32_t generation = 0;		/* # of times the file was reopened */
+static dev_t hist_dev;			/* the file hist_fd refers to */
+static ino_t hist_ino;
+
+static uint64_t *offsets = (uint64_t *) NULL;	/* offset of each entry */
+static uint32_t n_entries = 0, offsets_cap = 0;
+
+static uint32_t *sorted = (uint32_t *) NULL;	/* ids sorted by line */
+static uint32_t n_sorted = 0;		/* entries [0, n_sorted) sorted */
+
+static POSTINGS *trigrams = (POSTINGS *) NULL;
+static uint32_t n_trigrammed = 0;	/* entries [0, n) in trigrams */
+
+static uint32_t *found = (uint32_t *) NULL;	/* results of a search */
+static uint32_t n_found = 0, found_cap = 0;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	       History File Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Checksum of a line, seeded with its length. The line is zero
+ * padded to a multiple of 8 bytes after its '\0', so it is read a
+ * word at a time.
+ * @line: the line, in a record */
+static uint32_t checksum(const char *line, uint32_t len)
+{
+    size_t n = (len + 1 + 7) / 8;
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ len, w;
+
+    for (; n--; line += 8) {
+	memcpy(&w, line, 8);		/* records after a torn one may be unaligned */
+	h = (h ^ w) * 0x100000001b3ull;
+	h ^= h >> 29;
+    }
+    return (uint32_t) (h ^ (h >> 32));
+}
+
+/* Size of a record with a line of len bytes */
+static size_t record_size(uint32_t len)
+{
+    return (sizeof(RECORD) + len + 1 + 7) & ~(size_t) 7;
+}
+
+/* Check the record at an offset of the map.
+ * @return: its size; 0 if it is not a valid record */
+static size_t record_valid(size_t off)
+{
+    RECORD r;
+
+    if (off + sizeof(RECORD) > map_len)
+	return 0;
+    memcpy(&r, map + off, sizeof(RECORD));
+    if (!r.len || r.len > HIST_LINE_MAX || off + record_size(r.len) > map_len
+	    || map[off + sizeof(RECORD) + r.len] != '\0'
+	    || r.sum != checksum(map + off + sizeof(RECORD), r.len))
+	return 0;
+    return record_size(r.len);
+}
+
+/* Length of the line of an entry */
+static uint32_t entry_len(uint32_t id)
+{
+    uint32_t len;
+
+    memcpy(&len, map + offsets[id], sizeof(len));
+    return len;
+}
+
+/* Make the map cover the whole file.
+ * @return: 0 on success; -1 on error */
+static int remap(void)
+{
+    struct stat st;
+    char *m;
+
+    if (-1 == fstat(hist_fd, &st))
+	return -1;
+    if ((size_t) st.st_size == map_len)
+	return 0;
+    if (map)
+	m = mremap(map, map_len, st.st_size, MREMAP_MAYMOVE);
+    else
+	m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, hist_fd, 0);
+    if (m == MAP_FAILED)
+	return -1;
+    map = m;
+    map_len = st.st_size;
+    return 0;
+}
+
+/* Index the records past the last scan. A record which is not valid
+ * is skipped if a valid one follows it; otherwise it may still be
+ * being written, and the scan stops there until the next sync. */
+static void scan(void)
+{
+    size_t off, size, next;
+
+    for (off = scanned; off < map_len; off += size) {
+	if (!(size = record_valid(off))) {
+	    for (next = off + 1; next < map_len && !record_valid(next); next++)
+		;
+	    if (next >= map_len)
+		break;
+	    size = next - off;
+	    continue;
+	}
+	if (n_entries == offsets_cap) {
+	    offsets_cap = offsets_cap ? offsets_cap * 2 : 1024;
+	    if (!(offsets = (uint64_t *) realloc(offsets, offsets_cap * sizeof(uint64_t))))
+		die_with_error("realloc");
+	}
+	offsets[n_entries++] = off;
+    }
+    scanned = off;
+}
+
+/* Forget the mapped file and every index. */
+static void unmap(void)
+{
+    uint32_t i;
+
+    if (map)
+	munmap(map, map_len);
+    map = (char *) NULL;
+    map_len = scanned = 0;
+    n_entries = n_sorted = n_trigrammed = 0;
+    if (trigrams)
+	for (i = 0; i < (1u << TRI_BITS); i++)
+	    free(trigrams[i].ids);
+    free(trigrams);
+    trigrams = (POSTINGS *) NULL;
+}
+
+/* Open and map the history file the first time it is needed.
+ * @return: 0 if the history file is usable; -1 otherwise */
+static int hist_load(void)
+{
+    char buf[PATH_SIZE];
+    const char *path, *home;
+
+    if (hist_fd != -1 || hist_failed)
+	return hist_failed ? -1 : 0;
+
+    if (!(path = getenv("HISTFILE"))) {
+	if (!(home = getenv("HOME")))
+	    home = "";
+	snprintf(buf, sizeof(buf), "%s/.hsh_history", home);
+	path = buf;
+    }
+    return hist_open(path);
+}
+
+/* Has the history file been replaced (or removed) since it was
+ * opened?
+ * @st: set to the status of the file at its pathname
+ * @return: non-zero if so */
+static int replaced(struct stat *st)
+{
+    return -1 == stat(hist_path, st) || st->st_ino != hist_ino || st->st_dev != hist_dev;
+}
+
+/* Open the history file again, after it was replaced.
+ * @return: 0 on success; -1 on error */
+static int reopen(void)
+{
+    char *path = dupstr(hist_path);
+    int rel;
+
+    hist_close();
+    rel = hist_open(path);
+    free(path);
+    generation++;
+    return rel;
+}
+
+/* Write records, from entry first to the last, into a file.
+ * @return: 0 on success; -1 on error */
+static int write_entries(int fd, uint32_t first)
+{
+    size_t len = 0;
+    uint32_t i;
+
+    if (first >= n_entries)
+	return 0;
+    for (i = first; i < n_entries; i++)
+	len += record_size(entry_len(i));
+
+    /* the records are contiguous unless an invalid one was skipped */
+    if (offsets[n_entries-1] + record_size(entry_len(n_entries-1)) - offsets[first] == len)
+	return write(fd, map + offsets[first], len) == (ssize_t) len ? 0 : -1;
+    for (i = first; i < n_entries; i++) {
+	len = record_size(entry_len(i));
+	if (write(fd, map + offsets[i], len) != (ssize_t) len)
+	    return -1;
+    }
+    return 0;
+}
+
+/* Claim the compaction of the history file, so that instances
+ * sharing it don't compact at the same time. A claim left by a
+ * crashed instance is broken once stale.
+ * @claim: set to the pathname of the claim file
+ * @return: 0 if claimed; -1 otherwise */
+static int claim_compaction(char *claim, size_t size)
+{
+    struct stat st;
+    int fd;
+
+    snprintf(claim, size, "%s.compact", hist_path);
+    if (-1 == (fd = open(claim, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600))) {
+	if (errno != EEXIST || stat(claim, &st) || time(NULL) - st.st_mtime < CLAIM_STALE)
+	    return -1;
+	unlink(claim);
+	if (-1 == (fd = open(claim, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600)))
+	    return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+/* Rewrite the history file with its last keep entries, then copy
+ * the records other instances appended to the old file meanwhile.
+ * @return: 0 on success; -1 on error */
+static int compact(uint32_t keep)
+{
+    char tmp[PATH_SIZE], claim[PATH_SIZE];
+    uint32_t snapshot;
+    int fd, rel = -1;
+
+    if (claim_compaction(claim, sizeof(claim)))
+	return 0;		/* another instance is compacting */
+
+    /* the file may have been replaced before the claim */
+    if (hist_sync()) {
+	unlink(claim);
+	return -1;
+    }
+
+    /* write a new file, then put it in place */
+    snprintf(tmp, sizeof(tmp), "%s.%d", hist_path, (int) getpid());
+    if (-1 == (fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600))) {
+	fprintf(stderr, "-hsh: history: %s: %s\n", tmp, strerror(errno));
+	unlink(claim);
+	return -1;
+    }
+    snapshot = n_entries;
+    if (write(fd, HIST_MAGIC, HIST_MAGIC_LEN) != HIST_MAGIC_LEN
+	    || write_entries(fd, (n_entries > keep) ? n_entries - keep : 0)
+	    || rename(tmp, hist_path)) {
+	fprintf(stderr, "-hsh: history: %s: %s\n", tmp, strerror(errno));
+	unlink(tmp);
+	goto out;
+    }
+
+    /* records which reached the old file before the rename */
+    if (!remap()) {
+	scan();
+	write_entries(fd, snapshot);
+    }
+    rel = 0;
+
+out:
+    close(fd);
+    unlink(claim);
+    return reopen() ? -1 : rel;
+}
+
+/* Max # of entries to keep: $HISTSIZE, or HIST_SIZE */
+static uint32_t hist_size(void)
+{
+    const char *s = getenv("HISTSIZE");
+    long n = s ? atol(s) : 0;
+
+    return (n > 0 && n < (1L << 30)) ? n : HIST_SIZE;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	  Index Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* compare the lines of two entries, then their numbers */
+static int line_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    int cmp = strcmp(map + offsets[x] + sizeof(RECORD),
+		     map + offsets[y] + sizeof(RECORD));
+
+    return cmp ? cmp : (x > y) - (x < y);
+}
+
+static int id_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* Merge the entries past n_sorted into the sorted index. */
+static void sort_update(void)
+{
+    uint32_t i, j, k, n_new = n_entries - n_sorted, *tail, *merged;
+
+    if (!(tail = (uint32_t *) malloc((n_new + 1) * sizeof(uint32_t)))
+	    || !(merged = (uint32_t *) malloc((n_entries + 1) * sizeof(uint32_t))))
+	die_with_error("malloc");
+    for (i = 0; i < n_new; i++)
+	tail[i] = n_sorted + i;
+    qsort(tail, n_new, sizeof(uint32_t), line_cmp);
+
+    /* merge the old sorted ids with the new ones */
+    for (i = 0, j = 0, k = 0; k < n_entries; k++) {
+	if (j == n_new || (i < n_sorted && line_cmp(&sorted[i], &tail[j]) < 0))
+	    merged[k] = sorted[i++];
+	else
+	    merged[k] = tail[j++];
+    }
+    free(tail);
+    free(sorted);
+    sorted = merged;
+    n_sorted = n_entries;
+}
+
+/* Hash of the trigram at s */
+static uint32_t tri_hash(const char *s)
+{
+    uint32_t t = (unsigned char) s[0] << 16 | (unsigned char) s[1] << 8
+		 | (unsigned char) s[2];
+
+    return (t * 2654435761u) >> (32 - TRI_BITS);
+}
+
+/* Add the entries past n_trigrammed to the trigram index. */
+static void tri_update(void)
+{
+    uint32_t id, i, len;
+    const char *line;
+    POSTINGS *p;
+
+    if (!trigrams && !(trigrams = (POSTINGS *) calloc(1u << TRI_BITS, sizeof(POSTINGS))))
+	die_with_error("calloc");
+
+    for (id = n_trigrammed; id < n_entries; id++) {
+	len = entry_len(id);
+	line = map + offsets[id] + sizeof(RECORD);
+	for (i = 0; i + 3 <= len; i++) {
+	    p = &trigrams[tri_hash(line + i)];
+	    if (p->n && p->ids[p->n - 1] == id)
+		continue;
+	    if (p->n == p->cap) {
+		p->cap = p->cap ? p->cap * 2 : 4;
+		if (!(p->ids = (uint32_t *) realloc(p->ids, p->cap * sizeof(uint32_t))))
+		    die_with_error("realloc");
+	    }
+	    p->ids[p->n++] = id;
+	}
+    }
+    n_trigrammed = n_entries;
+}
+
+/* Add an entry to the results of a search. */
+static void found_add(uint32_t id)
+{
+    if (n_found == found_cap) {
+	found_cap = found_cap ? found_cap * 2 : 256;
+	if (!(found = (uint32_t *) realloc(found, found_cap * sizeof(uint32_t))))
+	    die_with_error("realloc");
+    }
+    found[n_found++] = id;
+}
+
+/* Find the entries starting with a prefix, through the sorted index
+ * and a scan of the entries not merged into it yet. */
+static void find_prefix(const char *prefix)
+{
+    size_t plen = strlen(prefix);
+    uint32_t lo = 0, hi, mid, id;
+
+    if (n_entries - n_sorted > HIST_TAIL_MAX)
+	sort_update();
+
+    /* first sorted entry not less than prefix */
+    for (hi = n_sorted; lo < hi; ) {
+	mid = lo + (hi - lo) / 2;
+	if (strcmp(map + offsets[sorted[mid]] + sizeof(RECORD), prefix) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    for (; lo < n_sorted; lo++) {
+	if (strncmp(map + offsets[sorted[lo]] + sizeof(RECORD), prefix, plen))
+	    break;
+	found_add(sorted[lo]);
+    }
+    for (id = n_sorted; id < n_entries; id++)
+	if (!strncmp(map + offsets[id] + sizeof(RECORD), prefix, plen))
+	    found_add(id);
+    qsort(found, n_found, sizeof(uint32_t), id_cmp);
+}
+
+/* Find the entries containing text: verify the entries of its
+ * rarest trigram, or scan them all if text is too short. */
+static void find_substring(const char *text)
+{
+    size_t tlen = strlen(text), i;
+    uint32_t id, j;
+    POSTINGS *p, *best = (POSTINGS *) NULL;
+
+    if (tlen < 3) {
+	for (id = 0; id < n_entries; id++)
+	    if (strstr(map + offsets[id] + sizeof(RECORD), text))
+		found_add(id);
+	return;
+    }
+
+    tri_update();
+    for (i = 0; i + 3 <= tlen; i++) {
+	p = &trigrams[tri_hash(text + i)];
+	if (!best || p->n < best->n)
+	    best = p;
+    }
+    for (j = 0; j < best->n; j++)
+	if (strstr(map + offsets[best->ids[j]] + sizeof(RECORD), text))
+	    found_add(best->ids[j]);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	   History Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Open and map a history file, creating it if needed. Done on first
+ * use of the history, so 'hsh -c' and scripts never touch it.
+ * @path: pathname of the history file
+ * @return: 0 on success; -1 if it can't be used */
+int hist_open(const char *path)
+{
+    struct stat st;
+
+    hist_fd = high_fd(open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600));
+    if (hist_fd == -1 || -1 == fstat(hist_fd, &st)
+	    || (!st.st_size && write(hist_fd, HIST_MAGIC, HIST_MAGIC_LEN) != HIST_MAGIC_LEN)
+	    || remap()) {
+	fprintf(stderr, "-hsh: history: %s: %s\n", path, strerror(errno));
+	goto fail;
+    }
+    if (map_len < HIST_MAGIC_LEN || memcmp(map, HIST_MAGIC, HIST_MAGIC_LEN)) {
+	fprintf(stderr, "-hsh: history: %s: not a hsh history file\n", path);
+	goto fail;
+    }
+    free(hist_path);
+    hist_path = dupstr((char *) path);
+    hist_dev = st.st_dev;
+    hist_ino = st.st_ino;
+    scanned = HIST_MAGIC_LEN;
+    scan();
+    return 0;
+
+fail:
+    if (hist_fd != -1)
+	close(hist_fd);
+    hist_fd = -1;
+    hist_failed = 1;
+    unmap();
+    return -1;
+}
+
+/* Pick up the records appended to the history file since the last
+ * sync, by this or other instances of hsh: a stat of the file, to
+ * see if it was replaced, and a scan from where the last one stopped.
+ * @return: 0 on success; -1 if there is no history file */
+int hist_sync(void)
+{
+    struct stat st;
+
+    if (hist_load() || (replaced(&st) && reopen()) || remap())
+	return -1;
+    pending = 0;
+    scan();
+    return 0;
+}
+
+/* Generation of the history: it changes whenever entries are
+ * renumbered, as the file was compacted.
+ * @return: the generation */
+uint32_t hist_generation(void)
+{
+    return generation;
+}
+
+/* Append a command line to the history file, as one record in a
+ * single write. The file is compacted when it holds twice the
+ * entries to keep.
+ * @line: the command line
+ * @return: 0 on success; -1 on error */
+int hist_add(const char *line)
+{
+    size_t len = strlen(line), size = record_size(len);
+    char stack_buf[512], *buf = stack_buf;
+    struct stat st;
+    RECORD r;
+    size_t avg;
+    int rel = 0;
+
+    if (!len || len > HIST_LINE_MAX || hist_load())
+	return -1;
+    if (size > sizeof(stack_buf) && !(buf = (char *) malloc(size)))
+	die_with_error("malloc");
+    memset(buf, 0, size);
+    memcpy(buf + sizeof(RECORD), line, len);
+    r.len = len;
+    r.sum = checksum(buf + sizeof(RECORD), len);
+    memcpy(buf, &r, sizeof(RECORD));
+
+    /* a single write to the end of the file; write it again as
+     * long as the file was replaced by a compaction meanwhile */
+    while (1) {
+	if (write(hist_fd, buf, size) != (ssize_t) size) {
+	    fprintf(stderr, "-hsh: history: %s: %s\n", hist_path, strerror(errno));
+	    rel = -1;
+	    break;
+	}
+	if (!replaced(&st))
+	    break;
+	if (reopen()) {		/* hist_open() reported it */
+	    rel = -1;
+	    break;
+	}
+    }
+    if (buf != stack_buf)
+	free(buf);
+    pending++;
+
+    /* entries in the file, guessed from its size as other
+     * instances may append to it too */
+    avg = n_entries ? (scanned - HIST_MAGIC_LEN) / n_entries : record_size(len);
+    if (!rel && n_entries + (st.st_size - scanned) / avg >= 2 * hist_size()
+	    && !hist_sync() && n_entries >= 2 * hist_size())
+	rel = compact(hist_size());
+    return rel;
+}
+
+/* # of entries in the history
+ * @return: # of entries; 0 if there is no history file */
+uint32_t hist_count(void)
+{
+    if (hist_load() || (pending && hist_sync()))
+	return 0;
+    return n_entries;
+}
+
+/* Get an entry of the history.
+ * @i: entry number, from 0 (oldest) to hist_count() - 1
+ * @return: the line, in the map; valid until the history changes */
+const char *hist_entry(uint32_t i)
+{
+    return map + offsets[i] + sizeof(RECORD);
+}
+
+/* Search the history.
+ * @text: the text to look for
+ * @prefix: non-zero to find entries starting with text, zero to
+ * 	    find entries containing it
+ * @ids: set to the entry numbers found, oldest first; valid until
+ * 	 the next search
+ * @return: # of entries found */
+uint32_t hist_find(const char *text, int prefix, const uint32_t **ids)
+{
+    n_found = 0;
+    *ids = found;
+    if (!hist_count())
+	return 0;
+    if (prefix)
+	find_prefix(text);
+    else
+	find_substring(text);
+    *ids = found;
+    return n_found;
+}
+
+/* Compact the history file down to the entries to keep.
+ * @return: 0 on success; -1 on error */
+int hist_compact(void)
+{
+    if (hist_load())
+	return -1;
+    return compact(hist_size());
+}
+
+/* Close the history file and release its memory. */
+void hist_close(void)
+{
+    unmap();
+    if (hist_fd != -1)
+	close(hist_fd);
+    hist_fd = -1;
+    hist_failed = pending = 0;
+    free(offsets);
+    free(sorted);
+    free(found);
+    offsets = (uint64_t *) NULL;
+    sorted = found = (uint32_t *) NULL;
+    offsets_cap = n_found = found_cap = 0;
+}
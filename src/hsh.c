@@ -25,17 +25,19 @@ struct List paths_list;
 /* current working directory: in absolute path name */
 char cwd[PATH_SIZE] = {0};
 
-/* current working directory: in relative path name */
-char rel_cwd[PATH_SIZE] = {0};
-
-/* system hostname hsh currently running on */
-static char hostname[30] = {0};
-
 /* a pointer to command line buffer */
 char *cmd_buf = (char*) NULL;
 
-/* a pointer to an array of PS_INFOs */
-PS_INFO *arr_ps_infos = (PS_INFO *) NULL;
+/* exit status of the last command executed */
+int last_status = 0;
+
+/* shared history ($HSH_HISTSHARE): lines of the history file
+ * readline has, and the generation of the file they were counted in */
+static int share_history = 0;
+static uint32_t hist_recalled = 0, hist_recalled_gen = 0;
+
+/* the command line being executed, for the job table */
+static const char *cur_cmdline = (const char *) NULL;
 
 //===================================================================//
 // 	     	 						     //
@@ -68,6 +70,20 @@ char *dupstr (char *s)
     return (r);
 }
 
+/* Move a descriptor hsh keeps for itself above the single digit
+ * ones a redirection can name, close-on-exec.
+ * @fd: the descriptor; closed unless it is returned
+ * @return: the descriptor moved; fd if it can't be */
+int high_fd(int fd)
+{
+    int high;
+
+    if (fd == -1 || fd >= 10 || -1 == (high = fcntl(fd, F_DUPFD_CLOEXEC, 10)))
+	return fd;
+    close(fd);
+    return high;
+}
+
 char *rl_dupstr (char *s)
 {
     char *r;
@@ -85,56 +101,33 @@ void set_paths_list(void)
     push(&paths_list, dupstr("/usr/bin"));
 }
 
-/* Convert absolute pathname into relative 
- * (to home directory) pathname. */
-void path_abs2rel()
+/* Get current working directory in abs pathname and set 
+ * environment variable 'PWD'; called whenever hsh changes
+ * its working directory. */
+void update_cwd(void)
 {
-	const char *home_dir = getenv("HOME");
-	char *path = NULL;
-
-	/* zero out buffers */
-	memset(cwd, 0, PATH_SIZE);
-	memset(rel_cwd, 0, PATH_SIZE);
-
-	/* get current working directory in abs pathname 
-	 * and set environment variable 'PWD' */
-	getcwd(cwd, PATH_SIZE);
-	setenv("PWD", cwd, 1);
-
-	/* make relative working directory path */
-	if (strstr(cwd, home_dir)) {  	
-		path = cwd + strlen(home_dir); 
-		strncat(rel_cwd, "~", 1);	
-		strncat(rel_cwd, path, strlen(path));
-	} else {			
-		strncpy(rel_cwd, cwd, strlen(cwd)+1);
-	}
+	if (getcwd(cwd, PATH_SIZE))
+		setenv("PWD", cwd, 1);
+	prompt_invalidate(PROMPT_CWD);
 }
 
-/* Update command line prompt.
- * @prompt_buf: buffer to hold the prompt string */
-void update_prompt(char **prompt_buf)
+/* Shared history: add to readline's history the lines saved to the
+ * history file since the last prompt, by this or other instances
+ * of hsh. Only the records appended since the last check are read. */
+static void recall_history(void)
 {
-	int len = strlen(getenv("USERNAME")) + strlen(hostname) 
-		+ strlen(rel_cwd) + strlen("@:# ");
-	
-	/* If the buffer has already been allocated, 
-	 * return the memory to the free pool. */
-	if (*prompt_buf) {
-        	free(*prompt_buf);
-		*prompt_buf = (char*) NULL;
-      	}
-
-	*prompt_buf = (char*) malloc(len*sizeof(char) + 1);
-	if (*prompt_buf == NULL)
-		die_with_error("malloc");
-	else	
-		memset(*prompt_buf, 0, sizeof(*prompt_buf));
-
-	/* make command line prompt */
-	strcat(strcat(*prompt_buf, getenv("USERNAME")), "@");
-	strcat(strcat(*prompt_buf, hostname), ":");
-	strcat(strcat(*prompt_buf, rel_cwd), "# ");
+	uint32_t n;
+
+	if (hist_sync())
+		return;
+	n = hist_count();
+	if (hist_recalled_gen != hist_generation() || hist_recalled > n) {
+		/* renumbered by a compaction: start from its end */
+		hist_recalled_gen = hist_generation();
+		hist_recalled = n;
+	}
+	for (; hist_recalled < n; hist_recalled++)
+		add_history(hist_entry(hist_recalled));
 }
 
 /* Readline_Gets function: 
@@ -142,8 +135,10 @@ void update_prompt(char **prompt_buf)
  * @prompt: prompt string buffer
  * @return: NULL on EOF && emptry string, 
  * otherwise a pointer to the string read. */
-char *rl_gets(char *prompt)
+char *rl_gets(const char *prompt)
 {
+	uint32_t gen;
+
 	/* If the buffer has already been allocated,
 	 * return the memory to the free pool. */
 	if (cmd_buf) {
@@ -151,66 +146,25 @@ char *rl_gets(char *prompt)
 		cmd_buf = (char *)NULL;
       	}
 
+	/* pick up the lines other instances saved */
+	if (share_history)
+		recall_history();
+
 	/* Get a line from the user. */
 	cmd_buf = readline(prompt);
 
-	/* If the line has any text in it, 
-	 * save it on the history. */
-	if (cmd_buf && *cmd_buf)
-        	add_history(cmd_buf);
+	/* If the line has any text in it, save it on the history
+	 * file and the history; with a shared history, the line
+	 * is recalled from the file at the next prompt. */
+	if (cmd_buf && *cmd_buf) {
+		gen = hist_generation();
+		if (hist_add(cmd_buf) || !share_history || gen != hist_generation())
+        		add_history(cmd_buf);
+	}
 
 	return (cmd_buf);
 }
 
-/* Parse command line string into tokens.
- * @args: a buffer to hold tokens
- * @return: # of tokens; -1 when too much tokens */
-int cmd_tokenizer(char **args)
-{
-    int  count = 0;
-    char *token;
-
-    token = strtok(cmd_buf, " \t");
-    while (token) {
-	args[count++] = token;
-	token = strtok(NULL, " \t");
-    }
-
-    if (count > MAX_NUM_ARGS) {
-        fprintf(stderr, "-hsh: too many arguments\n");
-        count = -1;
-    } else {
-	args[count] = NULL;
-    }
-    
-    return count;
-}
-
-/* Parse command line argment list for pipelining
- * @args: a buffer to hold tokens
- * @return: # of processes needs to fork; 
- * 	    1 if none;
- * 	   -1 if exception occurred */
-int parse_args(int nargs, char **args)
-{
-    int num_of_ps;
-
-    /* check syntax errors first */
-    if (pipe_exception_hdlr(nargs, args))
-	return -1;
-  
-    /* find the # of processes needed to fork */
-    num_of_ps = count_processes(args);
-
-    /* allocate memory for arr_ps_infos */
-    prepare_arg_lists(num_of_ps);
-
-    /* fill in information for arr_ps_infos */
-    if (arr_ps_infos)
-    	set_ps_infos(num_of_ps, args);
-    return num_of_ps;
-}
-
 /* Look up the name of a command.
  * @name: the name of the command
  * @return: a pointer to that BUILTIN entry;  
@@ -225,97 +179,159 @@ BUILTIN *find_builtins(char *name)
 	return (BUILTIN*)NULL;
 }
 
+/* Look up the builtin an expanded command line runs. A leading
+ * 'command' is dropped and bypasses the utility fast paths, so that
+ * 'command cat' runs cat from the path list; builtins proper, like
+ * cd, are still run by hsh.
+ * @pargs: the argument list; advanced past 'command'
+ * @nargs: # of arguments; updated likewise
+ * @return: the BUILTIN entry; NULL if the command is to be found 
+ * in the path list */
+BUILTIN *find_command(char ***pargs, int *nargs)
+{
+	BUILTIN *builtin;
+
+	if (*nargs < 2 || strcmp((*pargs)[0], "command"))
+	    return find_builtins((*pargs)[0]);
+	(*pargs)++;
+	(*nargs)--;
+	builtin = find_builtins((*pargs)[0]);
+	return (builtin && !builtin->utility) ? builtin : (BUILTIN*)NULL;
+}
+
 /* Execute builtin command.
  * @nargs: # of command line arguments
  * @args: a buffer to hold tokens
  * @return: -2 if command is not builtin cmd;
- * return 1 to break out loop;
- * return otherwise to continue loop */
+ * return -1 to break out loop;
+ * return exit status of the builtin otherwise */
 int execute_builtin(int nargs, char **args)
 {
+    int rel;
     BUILTIN *builtin = (BUILTIN*) NULL; 
 	
     if (!(builtin = find_builtins(args[0])))	/* command is not builtin */
 		return -2;
-    return (*(builtin->func))(nargs, args); 
+    rel = (*(builtin->func))(nargs, args); 
+
+    /* stdout may be a file or pipe; don't let output 
+     * linger in stdio buffer past redirections or forks */
+    fflush(stdout);
+    return rel;
 }
 
-/* Find executables in paths of paths_list.
- * @paths: paths list to be searched => paths_list
- * @args: command line argument list
- * @return: command path if found; otherwise NULL */
-char *find_cmd(struct List *paths, char *args[])
+/* Record exit status of a terminated child process.
+ * @wstatus: status value filled in by waitpid() */
+void set_last_status(int wstatus)
 {
-    int len;			/* pathname length */
-    char *path = (char *) NULL;	/* command path */
-    struct stat sb;		/* file status */
-    DIR *dir;			/* a strucutre representing directory */
-    struct dirent *entry;	/* an entry in directory dir */
-    struct Node *itr = paths->front;
+    if (WIFEXITED(wstatus))
+	last_status = WEXITSTATUS(wstatus);
+    else if (WIFSIGNALED(wstatus))
+	last_status = 128 + WTERMSIG(wstatus);
+}
 
-    /* build a temporary command path search list */
-    push_front(paths, ".");
-	
-    /* search path list for command args[0] */
-    while (args[0] && itr && itr != paths->tail) {
-	dir = opendir((char*)itr->data);
+/* Check whether a pathname names an executable regular file.
+ * @path: pathname to be checked
+ * @return: non-zero if path is executable */
+static int is_executable(const char *path)
+{
+    struct stat sb;		/* file status */
+    return !stat(path, &sb) && S_ISREG(sb.st_mode) && !access(path, X_OK);
+}
 
-	if (!dir) {
-	    perror("opendir");
-	    break;
-	}
+/* Search each directory in paths for an executable named name.
+ * @paths: paths list to be searched => paths_list
+ * @name: command name
+ * @buf: buffer of PATH_SIZE bytes to hold the resulting pathname
+ * @return: buf if found; otherwise NULL */
+char *search_paths(struct List *paths, const char *name, char *buf)
+{
+    struct Node *itr = paths->front;
 
-	len = strlen((char*)itr->data) + strlen("/") + strlen(args[0]);
-	
-	path = (char *) malloc(len + 1);
-	if (path) {
-	    memset(path, 0, 1);
-	    strcat(path, (char*)itr->data);
-	    strcat(strcat(path, "/"), args[0]);
-	} else {
-	    perror("malloc");
-	    break;
-	}
-	
-	stat(path, &sb);
-	while ((entry = readdir(dir)) != NULL) {
-	    if (!strcmp(entry->d_name, args[0]) && S_ISREG(sb.st_mode) && !access(path, X_OK)) {
-    		pop_front(paths);
-		closedir(dir);
-	    	return path;	/* command path found */
-	    }
-	}
-	
-	free(path);
+    while (itr && itr != paths->tail) {
+	if (snprintf(buf, PATH_SIZE, "%s/%s", (char*)itr->data, name) < PATH_SIZE
+		&& is_executable(buf))
+	    return buf;		/* command path found */
 	itr = itr->next;
-	closedir(dir);
     }
-   
-    /* restore original path search list */
-    pop_front(paths);
-    
-    /* not found */	 
-    return NULL;
+    return (char *) NULL;
+}
+
+/* Find executables in paths of paths_list. The current directory
+ * is tried first, then the command hash table, and only on a hash
+ * miss the directories in paths_list; a hit there is hashed.
+ * @paths: paths list to be searched => paths_list
+ * @args: command line argument list
+ * @return: command path if found, otherwise NULL; the returned
+ * 	    string is owned by hsh and must not be freed */
+char *find_cmd(struct List *paths, char *args[])
+{
+    char path[PATH_SIZE];	/* command path */
+    char *hashed;
+
+    if (!args[0] || !*args[0])
+	return (char *) NULL;
+
+    /* pathnames are never searched for */
+    if (strchr(args[0], '/'))
+	return is_executable(args[0]) ? args[0] : (char *) NULL;
+
+    /* current directory; never hashed since it changes */
+    if (snprintf(path, PATH_SIZE, "./%s", args[0]) < PATH_SIZE && is_executable(path))
+	return arena_strdup(path);
+
+    /* a hashed command may have been removed or moved since; like
+     * bash, forget it and search PATH again */
+    if ((hashed = hash_lookup(args[0]))) {
+	if (is_executable(hashed))
+	    return hashed;
+	hash_remove(args[0]);
+    }
+
+    if (search_paths(paths, args[0], path))
+	return hash_insert(args[0], path);
+
+    /* not found */
+    return (char *) NULL;
 }
 
 /* Execute system utilities or any executable found from find_cmd.
+ * The command is spawned with its redirections as file actions, so
+ * hsh's own stdio is left alone, and waited for as a foreground job.
  * @cmd_path: path of the command being execute
- * @args: command line arguments */
-void execute_cmd(char *cmd_path, char **args)
+ * @args: command line arguments
+ * @redirs: redirections to be done on the command
+ * @n_redirs: # of redirections */
+void execute_cmd(char *cmd_path, char **args, REDIR *redirs, int n_redirs)
 {
+    int status = 0, err;
     pid_t pid;
-    switch (pid = fork()) {
-	case -1:
-	    perror("fork");
-	    break;
-	case 0:		/* child process */
-	    execv(cmd_path, args);
-	    perror("execv");
-	    break;
-	default:	/* parent process */
-	    if (waitpid(pid, NULL, 0) != pid)
-		perror("waitpid");	
+    posix_spawn_file_actions_t actions;
+    JOB *job = job_begin(cur_cmdline, 1, 0);
+    uint64_t t = trace_begin();	    /* start of a traced phase */
+
+    posix_spawn_file_actions_init(&actions);
+    io_spawn_actions(&actions, redirs, n_redirs);
+    trace_end(TRACE_REDIR, t);
+
+    t = trace_begin();
+    pid = spawn_cmd(cmd_path, args, &actions, job);
+    trace_end(TRACE_SPAWN, t);
+    if (-1 == pid) {
+	err = errno;
+	if (io_diagnose(redirs, n_redirs)) {	/* a redirection failed */
+	    status = 1;
+	} else {
+	    fprintf(stderr, "-hsh: %s: %s\n", args[0], strerror(err));
+	    status = (err == ENOENT) ? 127 : 126;
+	}
     }
+    job_add_process(job, pid, status);
+
+    posix_spawn_file_actions_destroy(&actions);
+    t = trace_begin();
+    job_end(job, 0);
+    trace_end(TRACE_WAIT, t);
 }
 
 //===================================================================//
@@ -325,7 +341,7 @@ void execute_cmd(char *cmd_path, char **args)
 //===================================================================//
 
 /* Tell the GNU Readline library how to complete. We want to try to complete
- * on builtin names if this is the first word in the line, or on filenames
+ * on command names if this is the first word of a command, or on filenames
  * if not. */
 void initialize_readline (void)
 {
@@ -344,38 +360,40 @@ void initialize_readline (void)
 char **hsh_completion (const char *text, int start, int end)
 {
     char **matches = (char **)NULL;
+    int i = start;
+
+    (void) end;
 
-    /* If this word is at the start of the line, then it is a command
-     * to complete.  Otherwise it is the name of a file in the current
-     * directory. */
-    if (start == 0)
+    /* If this word is the first of a command, at the start of the line
+     * or after a pipe, then it is a command to complete, unless it is
+     * a pathname.  Otherwise it is the name of a file. */
+    while (i > 0 && isspace ((unsigned char) rl_line_buffer[i-1]))
+	i--;
+    if ((i == 0 || rl_line_buffer[i-1] == '|') && !strchr (text, '/'))
         matches = rl_completion_matches (text, command_generator);
+    else
+        matches = rl_completion_matches (text, rl_filename_completion_function);
 
+    /* no filename completion when no command matches */
+    rl_attempted_completion_over = 1;
     return (matches);
 }
 
 /* Generator function for command completion.  STATE lets us know whether
  * to start from scratch; without any state (i.e. STATE == 0), then we
- * start at the top of the list. */
+ * start at the top of the list.  Names come from the command index of
+ * complete.c, a range of which matches TEXT. */
 char *command_generator (const char *text, int state)
 {
-    static int list_index, len;
-    char *name;
-
-    /* If this is a new word to complete, initialize now.  This includes
-     * saving the length of TEXT for efficiency, and initializing the index
-     * variable to 0. */
-    if (!state) {
-	list_index = 0;
-	len = strlen (text);
-    }
+    static uint32_t next, last;
 
-    /* Return the next name which partially matches from the command list. */
-    while ((name = builtins[list_index].name)) {
-        list_index++;
-        if (strncmp (name, text, len) == 0)
-            return (rl_dupstr(name));
-    }
+    /* If this is a new word to complete, find its range of names. */
+    if (!state)
+	last = complete_find (text, &next) + next;
+
+    /* Return the next name of the range. */
+    if (next < last)
+	return (rl_dupstr ((char *) complete_name (next++)));
 
     /* If no names matched, then return NULL. */
     return ((char *)NULL);
@@ -387,142 +405,249 @@ char *command_generator (const char *text, int state)
 // 	     	 						     //
 //===================================================================//
 
-/* a macro as as shorthand for calling restore_stdio() 
- * and wordfree() together. */
-#define RSTDIO_FREEWD(w) do { restore_stdio(); wordfree(&w); } while (0)
-
-/* A function to perform words expansion for a single process.
- * @words: pointer to wordexp_t structure
- * @args: process argument list
- * @return: 1 if errors occurs otherwise 0 */
-int expand_words(wordexp_t *words, char **args)
-{
-    int i;
-
-    switch (wordexp(args[0], words, 0)) 
-    {
-	case 0:	break;
-	case WRDE_NOSPACE: wordfree(words);
-	default: return 1;
-    }
-
-    for(i = 1; args[i]; ++i) {
-	if (wordexp(args[i], words, WRDE_APPEND|WRDE_NOCMD|WRDE_UNDEF)) {
-	    wordfree(words);
-	    return 1;
-	}
-    }
-    return 0;
-}
-
 /* A function to execute single-threaded command.
- * @pnargs: pointer to nargs variable in execute_line() function
- * @args: cmd line argument list
+ * @ps: the process, with its argument list and redirections
  * @return: 1 to continue in loop in the calling function;
  * 	    0 to return normally to the calling function;
  * 	    -1 to break in the calling function */
-int single_threaded_cmd(int *pnargs, char **args)
+int single_threaded_cmd(PS_INFO *ps)
 {
-    int rel_blt;
+    int rel_blt, nargs;
+    int n_redirs = ps->n_redirs;
     char *cmd_path = (char*) NULL;  /* command path */
-    wordexp_t words;
+    char **args = ps->argv;
+    REDIR *redirs = ps->redirs;
+    uint64_t t = trace_begin();	    /* start of a traced phase */
+
+    rel_blt = expand_redirs(redirs, n_redirs);
+    trace_end(TRACE_EXPAND, t);
+    if (rel_blt) {
+	last_status = 1;
+	return 1;
+    }
+
+    /* nothing but redirections: just create the files */
+    if (!ps->argc) {
+	last_status = io_apply(redirs, n_redirs, 1);
+	restore_stdio();
+	return 1;
+    }
 
-    /* io redireciton and words expansion 
-     * return 1 if error occurs */
-    if (io_redirect(pnargs, args) || expand_words(&words, args))
+    /* words expansion; return 1 if error occurs */
+    t = trace_begin();
+    args = expand_words(args, &nargs);
+    trace_end(TRACE_EXPAND, t);
+    if (!args) {
+	last_status = 1;
 	return 1;
+    }
 
-    /* update argument list information */
-    args = words.we_wordv;
-    *pnargs = words.we_wordc;
+    /* builtins run inside hsh, so redirect hsh itself */
+    if (find_command(&args, &nargs)) {
+	t = trace_begin();
+	rel_blt = io_apply(redirs, n_redirs, 1);
+	trace_end(TRACE_REDIR, t);
+	if (rel_blt) {
+	    last_status = 1;
+	    restore_stdio();
+	    return 1;
+	}
 
-    /* execute builtin cmd and check for errors */
-    if (-1 == (rel_blt = execute_builtin(*pnargs, args))) {
-	RSTDIO_FREEWD(words);
-	return -1;
-    } else if (rel_blt >= 0) {
-	RSTDIO_FREEWD(words);
+	/* execute builtin cmd and check for errors */
+	t = trace_begin();
+	rel_blt = execute_builtin(nargs, args);
+	trace_end(TRACE_BUILTIN, t);
+	if (-1 == rel_blt) {
+	    restore_stdio();
+	    return -1;
+	}
+	last_status = rel_blt;
+	restore_stdio();
 	return 1;
     }
     
     /* execute system utility and check for errors */
-    if ((cmd_path = find_cmd(&paths_list, args))) {
+    t = trace_begin();
+    cmd_path = find_cmd(&paths_list, args);
+    trace_end(TRACE_FIND_CMD, t);
+    if (cmd_path) {
         /* reach here if it is a system utility command */
-	execute_cmd(cmd_path, args);
-        free(cmd_path);
-    } else if (*pnargs) {	
+	execute_cmd(cmd_path, args, redirs, n_redirs);
+    } else if (nargs) {	
     	/* no such command */
 	fprintf(stderr, "-hsh: %s: command not found\n", args[0]);
+	last_status = 127;
     }
-    
-    RSTDIO_FREEWD(words);
+
     return 0;
 }
 
-/* A function to execute single-threaded command.
- * @pnargs: pointer to nargs variable in execute_line() function
- * @args: cmd line argument list */
-void piped_single_threaded_cmd(int *pnargs, char **args)
+/* Run a builtin (or an empty command) in a forked child as part 
+ * of a pipeline; this is the fork fallback of the spawn backend.
+ * @nargs: # of arguments
+ * @args: expanded argument list
+ * @link: pipe ends of the process
+ * @redirs: redirections to be done on the process
+ * @n_redirs: # of redirections
+ * @job: the job the process belongs to
+ * @stage: index of the process in its pipeline
+ * @return: process id of the child; -1 on error */
+static pid_t piped_builtin_cmd(int nargs, char **args, PIPE_LINK *link,
+	REDIR *redirs, int n_redirs, JOB *job, int stage)
 {
     int rel_blt;
-    char *cmd_path = (char*) NULL;  /* command path */
-    wordexp_t words;
+    pid_t pid;
 
-    /* io redireciton and words expansion 
-     * terminate process if error occurs */
-    if (io_redirect(pnargs, args) || expand_words(&words, args))
-	_exit(EXIT_FAILURE);
+    if (-1 == (pid = fork())) {
+	perror("fork");
+	return -1;
+    } else if (pid) {
+	return pid;
+    }
 
-    /* update argument list information */
-    args = words.we_wordv;
-    *pnargs = words.we_wordc;
+    /* child process: join the job, connect pipes, then redirections */
+    job_child_setup(job);
+    if (-1 == dup_pipe_read_write(link))
+	_exit(EXIT_FAILURE);
+    if (io_apply(redirs, n_redirs, 0))
+	_exit(EXIT_FAILURE);
+    if (!nargs)
+	_exit(EXIT_SUCCESS);
+    sched_apply(stage);
 
     /* execute builtin cmd and check for errors */
-    if (-1 == (rel_blt = execute_builtin(*pnargs, args))) {
-	RSTDIO_FREEWD(words);
-	_exit(EXIT_FAILURE);
-    } else if (rel_blt >= 0) {
-	RSTDIO_FREEWD(words);
-	_exit(EXIT_SUCCESS);    /* terminate process */
+    if (-1 == (rel_blt = execute_builtin(nargs, args)))
+	_exit(last_status);
+    _exit(rel_blt);    /* terminate process */
+}
+
+/* A function to launch a single command of a pipeline. External 
+ * commands are spawned with their pipe ends and redirections as
+ * file actions; builtins fall back to fork.
+ * @ps: the process, with its argument list and redirections
+ * @link: pipe ends of the process
+ * @job: the job the process belongs to
+ * @stage: index of the process in its pipeline
+ * @return: process id of the command; -1 on error */
+pid_t piped_single_threaded_cmd(PS_INFO *ps, PIPE_LINK *link, JOB *job, int stage)
+{
+    int nargs, rel, err;
+    int n_redirs = ps->n_redirs;
+    char *cmd_path = (char*) NULL;  /* command path */
+    char **args = ps->argv;
+    REDIR *redirs = ps->redirs;
+    pid_t pid = -1;
+    posix_spawn_file_actions_t actions;
+    uint64_t t = trace_begin();	    /* start of a traced phase */
+
+    rel = expand_redirs(redirs, n_redirs);
+    trace_end(TRACE_EXPAND, t);
+    if (rel) {
+	last_status = 1;
+	return -1;
     }
-    
-    /* execute system utility and check for errors */
-    if ((cmd_path = find_cmd(&paths_list, args))) {
-        /* reach here if rel_blt == -2 && cmd_path != NULL */
-	execv(cmd_path, args);    // should not return
-	perror("execv");
-	_exit(EXIT_FAILURE);
-    } else if (*pnargs) {	
+
+    /* redirections are done in the child */
+    if (!ps->argc)
+	return piped_builtin_cmd(0, args, link, redirs, n_redirs, job, stage);
+
+    /* words expansion */
+    t = trace_begin();
+    args = expand_words(args, &nargs);
+    trace_end(TRACE_EXPAND, t);
+    if (!args) {
+	last_status = 1;
+	return -1;
+    }
+
+    if (find_command(&args, &nargs)) {
+	t = trace_begin();
+	pid = piped_builtin_cmd(nargs, args, link, redirs, n_redirs, job, stage);
+	trace_end(TRACE_SPAWN, t);
+	return pid;
+    }
+
+    t = trace_begin();
+    cmd_path = find_cmd(&paths_list, args);
+    trace_end(TRACE_FIND_CMD, t);
+    if (cmd_path && sched_active()) {
+	t = trace_begin();
+	if (-1 == (pid = fork_cmd(cmd_path, args, link, redirs, n_redirs, job, stage)))
+	    perror("fork");
+	trace_end(TRACE_SPAWN, t);
+    } else if (cmd_path) {
+	t = trace_begin();
+	posix_spawn_file_actions_init(&actions);
+	spawn_pipe_actions(&actions, link);
+	io_spawn_actions(&actions, redirs, n_redirs);
+	trace_end(TRACE_REDIR, t);
+
+	t = trace_begin();
+	pid = spawn_cmd(cmd_path, args, &actions, job);
+	trace_end(TRACE_SPAWN, t);
+	if (-1 == pid) {
+	    err = errno;
+	    if (io_diagnose(redirs, n_redirs)) {	/* a redirection failed */
+		last_status = 1;
+	    } else {
+		fprintf(stderr, "-hsh: %s: %s\n", args[0], strerror(err));
+		last_status = (err == ENOENT) ? 127 : 126;
+	    }
+	}
+	posix_spawn_file_actions_destroy(&actions);
+    } else if (nargs) {	
     	/* no such command and command line is not empty */
 	fprintf(stderr, "-hsh: %s: command not found\n", args[0]);
-    	RSTDIO_FREEWD(words);
-    	_exit(EXIT_FAILURE);
+	last_status = 127;
     }
-   
-    RSTDIO_FREEWD(words);
-    _exit(EXIT_SUCCESS);
+
+    return pid;
 }
 
-/* A function to execute multi-threaded command.
- * @n_of_th: number of threads in the line */
-void multi_threaded_cmd(int n_of_th)
+/* A function to execute multi-threaded command, or any command
+ * run in the background or with a 'sched' prefix. All processes
+ * form a single job.
+ * @pl: the pipeline of the command line */
+void multi_threaded_cmd(PIPELINE *pl)
 {
-    int i, pipes[n_of_th-1][2];
+    int i, n_of_th = pl->n_ps;
     pid_t pid;
+    PIPE_LINK link = { -1, -1, -1 };
+    JOB *job = job_begin(cur_cmdline, n_of_th, pl->background);
+    uint64_t t;			    /* start of a traced phase */
+
+    /* hsh launches every process of the pipeline itself;
+     * the pipe between two processes is set up right before 
+     * the first of them is launched */
+    for (i = 0; i < n_of_th; i++) {
+	if (-1 == set_pipes(&link, i, n_of_th, pl->ps[i].pipe_size)) {
+	    for (; i < n_of_th; i++)
+		job_add_process(job, -1, 1);
+	    break;
+	}
 
-    /* set up pipes for IPC */
-    if (-1 == set_pipes(pipes, n_of_th))
-	return;
-
-    /* forking processes; this is idiom for
-     * forking a 'chain' of processes. the idea 
-     * is to seperate processes creation with
-     * codes executed inside processes! */
-    for(i = n_of_th; i > 0; --i)    // watch out for index
-        if ((pid = fork())) break;
+	/* without job control, background jobs don't read the 
+	 * terminal or the script hsh is reading */
+	if (i == 0 && pl->background && !jobs_control())
+	    link.fd_in = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+	if (pl->ps[i].shards > 1)
+	    pid = shard_cmd(&pl->ps[i], &link, job, i);
+	else
+	    pid = piped_single_threaded_cmd(&pl->ps[i], &link, job, i);
+	job_add_process(job, pid, last_status);
+	close_pipes(&link);
+    }
+    close_pipes(&link);
+    if (link.fd_next != -1)
+	close(link.fd_next);
     
-    /* process code execution */
-    run_piped_process(n_of_th, i, pipes, pid);
+    /* wait for every process of a foreground pipeline, 
+     * growing its pipes if they are watched */
+    t = trace_begin();
+    job_end(job, pl->background);
+    trace_end(TRACE_WAIT, t);
+    pipe_unwatch();
 }
 
 //===================================================================//
@@ -531,71 +656,119 @@ void multi_threaded_cmd(int n_of_th)
 // 	     	 						     //
 //===================================================================//
 
+/* Initialize what only the interactive shell needs: readline
+ * and history. Done on first interactive use, so 'hsh -c' and
+ * scripts start without them. */
+static void init_interactive(void)
+{
+    uint32_t i, n;
+
+    /* Bind our completer. */	
+    initialize_readline();
+	
+    /* start using history; recall the last lines of the
+     * history file, which is mapped rather than read */
+    using_history();
+    n = hist_count();
+    for (i = (n > HIST_RECALL) ? n - HIST_RECALL : 0; i < n; i++)
+	add_history(hist_entry(i));
+    hist_recalled = n;
+    hist_recalled_gen = hist_generation();
+    share_history = getenv("HSH_HISTSHARE") && *getenv("HSH_HISTSHARE");
+}
+
 /* Initialize environment variables 
- * before entering shell */
+ * before entering shell; kept to the minimum every mode
+ * needs, since hsh may be started thousands of times */
 void init_shell()
 {
     /* creat environmental variables for shell */
     list_init(&dirs_stack);
     list_init(&paths_list);
-	
-    /* get hostname */
-    if (gethostname(hostname, sizeof(hostname)))
-	die_with_error("gethostname");
 
     /* initialize paths_list */
     set_paths_list();
 
-    /* Bind our completer. */	
-    initialize_readline();
-	
-    /* start using history */
-    using_history();
+    /* initialize cwd and 'PWD' */
+    update_cwd();
+
+    /* reap background jobs */
+    jobs_init();
+    trace_init();
+}
+
+/* Execute a single command line. Everything the line allocated
+ * from the per-line arena is released once it is done.
+ * @line: the command line string
+ * @return: -1 if the shell should exit; otherwise 0 */
+int execute_cmdline(char *line)
+{
+    int rel = 0;
+    PIPELINE *pl;		    /* syntax tree of the command line */
+    uint64_t t_line = trace_begin(), t;
+
+    /* report background jobs done since the last line */
+    jobs_notify();
+    cur_cmdline = line;
+
+    /* parse command line string in a single pass */
+    t = trace_begin();
+    pl = parse_line(line);
+    trace_end(TRACE_PARSE, t);
+    if (!pl || !(cur_cmdline = time_prefix(pl, line)) || -1 == sched_prefix(pl)) {
+	last_status = 2;
+    } else if (1 == pl->n_ps && !pl->background && !sched_active()) {
+	/* single-threaded command */
+	if (-1 == single_threaded_cmd(&pl->ps[0]))
+	    rel = -1;
+	else
+	    set_pipe_status(&last_status, 1);
+    } else if (pl->n_ps) {	    /* multi-threaded, background or 'sched' command */
+	multi_threaded_cmd(pl);
+    }
+
+    time_end();
+    trace_end(TRACE_LINE, t_line);
+    arena_reset();
+    return rel;
 }
 
-/* Execute command line */ 
+/* Execute command line interactively */ 
 void execute_line()
 {
-    int nargs;			    /* # of args */
-    int rel_stc;		    /* return value of single_threaded_cmd() */
-    int n_of_ps;		    /* number of processes needed to fork */
-	
-    char *prompt  = (char*) NULL;   /* command line prompt */
-    char *args[MAX_NUM_ARGS+1];	    /* buffer holding cmd line args */
+    const char *prompt;		    /* command line prompt */
+    uint64_t t;			    /* start of a traced phase */
+
+    /* interactive: readline and history */
+    init_interactive();
+
+    /* interactive: give each job its own process group */
+    jobs_enable_control();
 
     while (1) {
-	/* get current working directory in relative path to 
-	 * home directory */	
-	path_abs2rel();
-	
-	/* making command line prompt for user */
-	update_prompt(&prompt);
+	/* report background jobs done or stopped */
+	jobs_notify();
+
+	/* command line prompt for user; rendered again only
+	 * if something it shows has changed */
+	t = trace_begin();
+	prompt = prompt_get();
+	trace_end(TRACE_PROMPT, t);
 	
 	/* display shell prompt and read user inputs */
-	if (rl_gets(prompt) == NULL || !*cmd_buf)
-	    continue;
-	
-	/* tokenize command line string */
-	if (-1 == (nargs = cmd_tokenizer(args)))
-	    continue;
-
-	/* parse argument list for pipelining */
-	if (-1 == (n_of_ps = parse_args(nargs, args)))
-	    continue;
-
-	/* execute commands */
-	if (1 == n_of_ps) {     /* single-threaded command */
-	    rel_stc = single_threaded_cmd(&(arr_ps_infos[0].argc), arr_ps_infos[0].argv);
-	    if (rel_stc ==  1) continue;
-	    if (rel_stc == -1) break;
-	} else {		/* multi-threaded command */
-	    multi_threaded_cmd(n_of_ps);
+	t = trace_begin();
+	if (rl_gets(prompt) == NULL) {
+	    putchar('\n');	/* EOF: leave the terminal on a new line */
+	    break;
 	}
+	trace_end(TRACE_READLINE, t);
+	
+	if (-1 == execute_cmdline(cmd_buf))
+	    break;
     }
 
     /* release memory from control */
-    if (prompt)
-       	free(prompt);
+    arena_reset();
     if (cmd_buf)
        	free(cmd_buf);
 }
@@ -606,6 +779,12 @@ void clean_shell()
 {
     list_clean(&dirs_stack);
     list_clean(&paths_list);
-    clear_ps_infos(arr_ps_infos);
+    hash_clear();
+    expand_clean();
+    jobs_clean();
+    prompt_clean();
+    hist_close();
+    complete_clean();
+    arena_clean();
     clear_history();
 }
@@ -13,28 +13,126 @@
 #include <sys/wait.h>
 #include <dirent.h>
 #include <fcntl.h>
-#include <wordexp.h>		/* GNU C library pattern word expansion */
+#include <signal.h>
+#include <spawn.h>		/* POSIX process spawning */
+#include <ctype.h>
+#include <glob.h>		/* pathname expansion */
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>	/* rusage */
+#include <sched.h>		/* CPU affinity */
+#include <sys/syscall.h>	/* pidfd_open */
 #include <readline/readline.h>	/* The GNU readline library */
 #include <readline/history.h>	/* The GNU history library */
 #include "list.h"
 
 /* definition of symbolic constants */
-#define MAX_NUM_ARGS 256
 #define PATH_SIZE 4096
 #define TRUE 1
 #define FALSE 0
 
+/* lines of the history file readline recalls at startup */
+#define HIST_RECALL 1000
+
+/* report formats of the 'time' prefix */
+#define TIME_TEXT 1
+#define TIME_JSON 2
+
+/* phases of running a command line, as recorded by tracing */
+#define TRACE_PROMPT_CWD 0
+#define TRACE_PROMPT	1
+#define TRACE_READLINE	2
+#define TRACE_LINE	3
+#define TRACE_PARSE	4
+#define TRACE_EXPAND	5
+#define TRACE_REDIR	6
+#define TRACE_FIND_CMD	7
+#define TRACE_BUILTIN	8
+#define TRACE_SPAWN	9
+#define TRACE_WAIT	10
+#define N_TRACE_PHASES	11
+
+/* how often full pipes are looked for with 'pipesize auto' */
+#define PIPE_TICK_MS	10
+
+/* max # of copies of a sharded stage ('|N8') */
+#define SHARD_MAX	256
+
+/* what changed, for the prompt engine */
+#define PROMPT_CWD	1	/* the working directory */
+#define PROMPT_VARS	2	/* environment variables */
+
 /*========================= 
  * Global Data Structures *
  =========================*/
 
+/* A structure which describes a single IO redirection, 
+ * e.g. '> file', '2> file' or '2>&1', to be done on a process */
+typedef struct {
+    int fd;		/* file descriptor being redirected; REDIR_OUT_ERR */
+    int flags;		/* open(2) flags for the file */
+    int dup;		/* fd duplicated onto fd ('N>&M'); -1 for a file */
+    char *path;		/* pathname of the file; NULL if dup is set */
+} REDIR;
+
+#define REDIR_OUT_ERR	-1	/* fd of '&> file': both stdout and stderr */
+
 /* A structure which contains information a process 
- * needs, namely, # of arguments and argument list  */
+ * needs, namely, its argument list and redirections */
 typedef struct {
     int argc;		/* # of cmd line arguments to a process */
     char **argv;	/* the argument list of that process */
+    int n_redirs;	/* # of IO redirections of that process */
+    REDIR *redirs;	/* the IO redirections of that process */
+    long pipe_size;	/* capacity of the pipe it writes to ('|[1M]');
+			   0 for the default of 'pipesize' */
+    int shards;		/* # of copies it runs as ('|N8'); 0 if one */
+    int shard_order;	/* non-zero to merge their outputs in input
+			   order ('|N8o') */
 } PS_INFO;
 
+/* A structure which is the syntax tree of a command line:
+ * processes connected by pipes */
+typedef struct {
+    int n_ps;		/* # of processes in the pipeline */
+    PS_INFO *ps;	/* the processes, from left to right */
+    int background;	/* non-zero if the line ends with '&' */
+} PIPELINE;
+
+/* A structure which describes a launched process of a job */
+typedef struct {
+    pid_t pid;		/* process id; -1 if it failed to launch */
+    int status;		/* exit status once done or stopped */
+    int state;		/* running, stopped or done */
+    struct timespec start;	/* when it was launched */
+    struct timespec end;	/* when it was reaped */
+    struct rusage ru;	/* resource usage once done */
+} PROCESS;
+
+/* A structure which describes a job: the processes of a pipeline,
+ * which share a process group under job control */
+typedef struct {
+    int id;		/* job number, as in '%1' */
+    pid_t pgid;		/* process group id; pid of first process */
+    int foreground;	/* non-zero while waited for in foreground */
+    int n_ps;		/* # of processes launched so far */
+    PROCESS *ps;	/* the processes, from left to right */
+    char *cmd;		/* command line, as shown by 'jobs' */
+    int timed;		/* TIME_* report format; 0 if not timed */
+} JOB;
+
+/* A structure which holds the pipe ends of a single process
+ * in a pipeline while it is being launched */
+typedef struct {
+    int fd_in;		/* read end of previous pipe; -1 if none */
+    int fd_out;		/* write end of next pipe; -1 if none */
+    int fd_next;	/* read end of next pipe, for next process */
+} PIPE_LINK;
+
 /* A structure which contains information on the shell 
  * builtin commands this program can understand */
 typedef int hsh_btfunc_t (int, char**);	/* builtin function pointer type */
@@ -43,6 +141,8 @@ typedef struct {
     char *name;		/* user printable name */
     char *doc;		/* documentation string for this function */
     hsh_btfunc_t *func;	/* function to call to do the job */
+    int utility;	/* a fast path of an external utility, which
+			   'command' bypasses */
 } BUILTIN;
 
 /*====================== 
@@ -54,6 +154,8 @@ void list_clean(struct List *list);
 
 /* hsh helper function signatures */
 char *dupstr (char *s);
+int high_fd(int fd);
+void update_cwd(void);
 void die_with_error(char *msg);
 
 /* readline interface */
@@ -62,26 +164,119 @@ void initialize_readline (void);
 char *command_generator(const char *, int);
 char **hsh_completion(const char *, int, int);
 
+/* command completion interface */
+uint32_t complete_find(const char *prefix, uint32_t *first);
+const char *complete_name(uint32_t i);
+void complete_invalidate(void);
+void complete_clean(void);
+
+/* per-line arena interface */
+void *arena_alloc(size_t size);
+char *arena_strdup(const char *s);
+void arena_reset(void);
+void arena_clean(void);
+
+/* word expansion interface */
+char **expand_words(char **args, int *pnargs);
+int expand_redirs(REDIR *redirs, int n);
+void expand_clean(void);
+
+/* command hash table interface */
+char *hash_lookup(const char *name);
+char *hash_insert(const char *name, const char *path);
+void hash_remove(const char *name);
+void hash_clear(void);
+int hash_size(void);
+int hash_traversal(void (*f)(int hits, const char *name, const char *path));
+
+/* exit status interface */
+void set_last_status(int wstatus);
+
+/* builtin lookup interface */
+BUILTIN *find_builtins(char *name);
+BUILTIN *find_command(char ***pargs, int *nargs);
+int execute_builtin(int nargs, char **args);
+
+/* command search interface */
+char *search_paths(struct List *paths, const char *name, char *buf);
+char *find_cmd(struct List *paths, char *args[]);
+
 /* IO redirection interface */
-int io_exception_hdlr(int nargs, char **args);
-int io_redirect(int *pnargs, char **args);
+int io_apply(REDIR *redirs, int n, int save);
+void io_spawn_actions(posix_spawn_file_actions_t *actions, REDIR *redirs, int n);
+int io_diagnose(REDIR *redirs, int n);
 void restore_stdio(void);
 
+/* process spawning interface */
+pid_t spawn_cmd(char *cmd_path, char **args, posix_spawn_file_actions_t *actions,
+	JOB *job);
+void spawn_pipe_actions(posix_spawn_file_actions_t *actions, PIPE_LINK *link);
+pid_t fork_cmd(char *cmd_path, char **args, PIPE_LINK *link, REDIR *redirs,
+	int n_redirs, JOB *job, int stage);
+
 /* Pipeline interface */
-int pipe_exception_hdlr(int nargs, char **args);
-int set_pipes(int (*pipes)[2], int n_of_th);
-int wait_first_child(pid_t pid);
-int dup_pipe_read(int (*pipes)[2], int idx, int n_of_th);
-int dup_pipe_write(int (*pipes)[2], int idx, int n_of_th);
-int dup_pipe_read_write(int (*pipes)[2], int idx, int n_of_th);
-void close_pipes(int (*pipes)[2], int n_of_th);
-void run_piped_process(int n_of_th, int i, int (*pipes)[], pid_t pid); 
+int set_pipes(PIPE_LINK *link, int idx, int n_of_th, long size);
+void close_pipes(PIPE_LINK *link);
+int pipe_adapt(void);
+void pipe_unwatch(void);
+int builtin_pipesize(int nargs, char **args);
+void set_pipe_status(int *status, int n_of_th);
+int dup_pipe_read_write(PIPE_LINK *link);
+
+/* job interface */
+void jobs_init(void);
+void jobs_enable_control(void);
+int jobs_control(void);
+JOB *job_begin(const char *cmd, int n_ps, int background);
+void job_add_process(JOB *job, pid_t pid, int status);
+void job_end(JOB *job, int background);
+void job_spawn_attr(posix_spawnattr_t *attr, JOB *job);
+void job_child_setup(JOB *job);
+void jobs_notify(void);
+void jobs_clean(void);
+
+/* timing interface */
+const char *time_prefix(PIPELINE *pl, const char *line);
+int time_take(void);
+void time_start(PROCESS *p);
+void time_stop(PROCESS *p);
+void time_report(JOB *job);
+void time_end(void);
+
+/* scheduling interface */
+int sched_prefix(PIPELINE *pl);
+int sched_active(void);
+void sched_apply(int stage);
+
+/* sharded stage interface */
+pid_t shard_cmd(PS_INFO *ps, PIPE_LINK *link, JOB *job, int stage);
+
+/* tracing interface */
+void trace_init(void);
+void trace_enable(int on);
+uint64_t trace_begin(void);
+void trace_end(int phase, uint64_t start);
+
+/* prompt interface */
+const char *prompt_get(void);
+void prompt_invalidate(int what);
+void prompt_clean(void);
+
+/* history file interface */
+int hist_open(const char *path);
+int hist_sync(void);
+uint32_t hist_generation(void);
+int hist_add(const char *line);
+uint32_t hist_count(void);
+const char *hist_entry(uint32_t i);
+uint32_t hist_find(const char *text, int prefix, const uint32_t **ids);
+int hist_compact(void);
+void hist_close(void);
 
 /* command line parsing interface */
-int count_processes(char **args); 
-void prepare_arg_lists(int num_of_ps);
-void set_ps_infos(int num_of_ps, char **args);
-void clear_ps_infos(PS_INFO *array);
+PIPELINE *parse_line(const char *line);
+int parse_redir(const char *p, REDIR *redir);
+long parse_size(const char *s, const char **end);
 
 /* builtin command interface */
 int builtin_exit(int nargs, char **args);
@@ -93,11 +288,35 @@ int builtin_popd(int nargs, char **args);
 int builtin_dirs(int nargs, char **args);
 int builtin_path(int nargs, char **args);
 int builtin_history(int nargs, char **args);
+int builtin_hash(int nargs, char **args);
 int builtin_kill(int nargs, char **args);
 int builtin_jobs(int nargs, char **args);
+int builtin_wait(int nargs, char **args);
+int builtin_fg(int nargs, char **args);
+int builtin_bg(int nargs, char **args);
+int builtin_parallel(int nargs, char **args);
+int builtin_trace(int nargs, char **args);
+int builtin_export(int nargs, char **args);
+int builtin_unset(int nargs, char **args);
+
+/* utility fast path interface */
+int builtin_true(int nargs, char **args);
+int builtin_false(int nargs, char **args);
+int builtin_test(int nargs, char **args);
+int builtin_printf(int nargs, char **args);
+int builtin_cat(int nargs, char **args);
+int builtin_basename(int nargs, char **args);
+int builtin_dirname(int nargs, char **args);
+
+/* non-interactive (batch) interface */
+int execute_fd(int fd);
+int execute_file(const char *pathname);
+int execute_string(const char *str);
 
 /* hsh interface */
 void init_shell();
+int execute_cmdline(char *line);
+pid_t piped_single_threaded_cmd(PS_INFO *ps, PIPE_LINK *link, JOB *job, int stage);
 void execute_line();
 void clean_shell();
 
@@ -12,7 +12,10 @@
 // 	     	 						     //
 //===================================================================//
 
-int stdin_save = -1, stdout_save = -1, stderr_save = -1;
+/* Descriptors hsh redirected for a builtin, with a close-on-exec 
+ * copy of each (-1 if it was not open) for restore_stdio() */
+static int saved_fd[10], saved_copy[10];
+static int n_saved = 0;
 
 //===================================================================//
 // 	     	 						     //
@@ -20,109 +23,82 @@ int stdin_save = -1, stdout_save = -1, stderr_save = -1;
 // 	     	 						     //
 //===================================================================//
 
-/* Check for command line syntax errors.
- * @nargs: # of arguments
- * @args: command line argument buffer
- * @return: 0 if no exceptions found otherwise non-zero */
-int io_exception_hdlr(int nargs, char **args)
+/* Save a file descriptor of hsh before it is redirected, unless it
+ * already was. The copy is above the single digit fds a redirection
+ * can name and close-on-exec, so no child inherits it.
+ * @fd: the file descriptor */
+static void save_fd(int fd)
 {
-    int i, exception = 0;
-
-    /* check for exceptions */
-    if (nargs==1 && (!strcmp(args[0], ">")  || !strcmp(args[0], "<") || 
-	    	     !strcmp(args[0], "1>") || !strcmp(args[0], "2>")))
-	    exception = 1;
-    if (!strcmp(args[nargs-1], ">") || !strcmp(args[nargs-1], "<"))
-	    exception = 2;
-    for (i = 0; !exception && i<(nargs-1); i++) // i must start with 0
-	if ((!strcmp(args[i], ">") && !strcmp(args[i+1], ">")) ||
-	    (!strcmp(args[i], ">") && !strcmp(args[i+1], "<")) ||	
-	    (!strcmp(args[i], "<") && !strcmp(args[i+1], ">")) ||
-	    (!strcmp(args[i], "<") && !strcmp(args[i+1], "<")) ||
-	    (!strcmp(args[i], "2>") && !strcmp(args[i+1], "2>")))
-	    exception = 3;
-
-    /* exception handling */
-    if (exception == 1)
-	fprintf(stderr, "-hsh: syntax error near unexpected token 'newline'\n");
-    else if (exception == 2)
-	fprintf(stderr, "-hsh: syntax error near unexpected token '%s'\n", args[nargs-1]);
-    else if (exception == 3)
-	fprintf(stderr, "-hsh: syntax error near unexpected token '%s'\n", args[i]);
-    return exception;
-}
+    int i;
 
-/* Set stdin to file
- * @pfd: pointer to file descriptor of that file
- * @pathname: file pathname which stdin redirects to
- * @return: 0 if no errors otherwise -1 */
-int redirect_stdin(int *pfd, char *pathname)
-{
-    if (-1 == (*pfd = open(pathname, O_RDONLY)))
-	fprintf(stderr, "-hsh: %s: %s\n", pathname, strerror(errno));
-    else if (dup2(*pfd, STDIN_FILENO) != STDIN_FILENO)
-	perror("dup2 error for stdin");
-    else
-	close(*pfd);
-    return (errno) ? -1 : 0;
+    for (i = 0; i < n_saved; i++)
+	if (saved_fd[i] == fd)
+	    return;
+    saved_fd[n_saved] = fd;
+    saved_copy[n_saved++] = fcntl(fd, F_DUPFD_CLOEXEC, 10);
 }
 
-/* Set stdout to file
- * @pfd: pointer to file descriptor of that file
- * @pathname: file pathname which stdout redirects to
- * @return: 0 if no errors otherwise -1 */
-int redirect_stdout(int *pfd, char *pathname)
+/* Is a descriptor one hsh keeps for itself, such as its history
+ * file, a script being read or a pipe of the pipeline being
+ * launched? Those are all close-on-exec, and a descriptor hsh was
+ * given never is, so none of them can be duplicated into a command.
+ * @fd: the file descriptor
+ * @return: non-zero if so */
+static int internal_fd(int fd)
 {
-    if (-1 == (*pfd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0666)))
-	fprintf(stderr, "-hsh: %s: %s\n", pathname, strerror(errno));
-    else if (dup2(*pfd, STDOUT_FILENO) != STDOUT_FILENO)
-	perror("dup2 error for stdout");
-    else
-	close(*pfd);
-    return (errno) ? -1 : 0;
-}
+    int flags = fcntl(fd, F_GETFD);
 
-/* Redirect stdout to file for append
- * @pfd: pointer to file descriptor of that file
- * @pathname: file pathname which stdout redirects to
- * @return: 0 if no errors otherwise -1 */
-int redirect_stdout_append(int *pfd, char *pathname)
-{
-    if (-1 == (*pfd = open(pathname, O_WRONLY | O_CREAT | O_APPEND, 0666)))
-	fprintf(stderr, "-hsh: %s: %s\n", pathname, strerror(errno));
-    else if (dup2(*pfd, STDOUT_FILENO) != STDOUT_FILENO)
-	perror("dup2 error for stdout");
-    else
-	close(*pfd);
-    return (errno) ? -1 : 0;
+    return flags != -1 && (flags & FD_CLOEXEC);
 }
 
-/* Set stderr to file
- * @pfd: pointer to file descriptor of that file
- * @pathname: file pathname which stderr redirects to
+/* Redirect a file descriptor to a file or to another descriptor.
+ * @redir: the redirection to be done
  * @return: 0 if no errors otherwise -1 */
-int redirect_stderr(int *pfd, char *pathname)
+static int redirect_fd(REDIR *redir)
 {
-    if (-1 == (*pfd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0666)))
-	fprintf(stderr, "-hsh: %s: %s\n", pathname, strerror(errno));
-    else if (dup2(*pfd, STDERR_FILENO) != STDERR_FILENO)
-	perror("dup2 error for stderr");
+    int fd, rel = -1;
+    int target = (redir->fd == REDIR_OUT_ERR) ? STDOUT_FILENO : redir->fd;
+
+    if (redir->dup != -1) {
+	if (internal_fd(redir->dup))
+	    errno = EBADF;
+	else if (-1 != fcntl(redir->dup, F_GETFD)
+		&& (redir->dup == target || dup2(redir->dup, target) == target))
+	    return 0;
+	fprintf(stderr, "-hsh: %d: %s\n", redir->dup, strerror(errno));
+	return -1;
+    }
+
+    if (-1 == (fd = open(redir->path, redir->flags, 0666)))
+	fprintf(stderr, "-hsh: %s: %s\n", redir->path, strerror(errno));
+    else if (fd == target)
+	rel = 0;
+    else if (dup2(fd, target) != target)
+	perror("dup2");
     else
-	close(*pfd);
-    return (errno) ? -1 : 0;
+	rel = close(fd);
+
+    if (!rel && redir->fd == REDIR_OUT_ERR && dup2(STDOUT_FILENO, STDERR_FILENO) == -1) {
+	perror("dup2");
+	rel = -1;
+    }
+    return rel;
 }
 
-/* Remove arguments from argument list
- * @idx: starting index for processing
- * @pnargs: pointer to nargs variable
- * @args: command line argument buffer */
-void del_args(int idx, int *pnargs, char **args)
+/* Is a file descriptor the target of one of the first redirections?
+ * @redirs: redirections of the process
+ * @n: # of redirections to look at
+ * @fd: the file descriptor
+ * @return: non-zero if so */
+static int redirected(REDIR *redirs, int n, int fd)
 {
-    int j;
-    for (j = idx; j < *pnargs-2; j++)
-        args[j] = args[j+2];
-    args[j] = NULL;
-    *pnargs -= 2;
+    int i;
+
+    for (i = 0; i < n; i++)
+	if (redirs[i].fd == fd || (redirs[i].fd == REDIR_OUT_ERR
+		    && (fd == STDOUT_FILENO || fd == STDERR_FILENO)))
+	    return 1;
+    return 0;
 }
 
 //===================================================================//
@@ -131,51 +107,93 @@ void del_args(int idx, int *pnargs, char **args)
 // 	     	 						     //
 //===================================================================//
 
-/* Redirect command line IO
- * @pnargs: pointer to nargs variable
- * @args: command line argument buffer
+/* Perform redirections on the calling process: hsh itself for a
+ * builtin, or a forked child. External commands never come here;
+ * their redirections are file actions (see io_spawn_actions()).
+ * @redirs: redirections of the process
+ * @n: # of redirections
+ * @save: non-zero to save the descriptors for restore_stdio(), 
+ * 	  i.e. if the calling process is hsh itself
  * @return: 0 if no exceptions otherwise 1 */
-int io_redirect(int *pnargs, char **args)
+int io_apply(REDIR *redirs, int n, int save)
 {
-    int i = 0, rel = 0, fd[3];	/* i needs to be started with 0 */
-
-    //if (io_exception_hdlr(*pnargs, args))
-	//return 1; // checked inside pipe_exception_hdlr()
-
-    /* IMPORTANT! MUST remove io operators and associated 
-     * file names in args; using del_args() to do that */
-    while (i < *pnargs-1) {
-	if (!strcmp(args[i], "<")) {
-	    if(stdin_save == -1) stdin_save = dup(STDIN_FILENO);
-	    if (-1 == (rel = redirect_stdin(&fd[0], args[i+1]))) break;
-	    else del_args(i, pnargs, args);
-	} else if (!strcmp(args[i], ">") || !strcmp(args[i], "1>")) {
-	    if(stdout_save == -1) stdout_save = dup(STDOUT_FILENO);
-	    if (-1 == (rel = redirect_stdout(&fd[1], args[i+1]))) break;
-	    else del_args(i, pnargs, args);
-	} else if (!strcmp(args[i], ">>")) {
-	    if(stdout_save == -1) stdout_save = dup(STDOUT_FILENO);
-	    if (-1 == (rel = redirect_stdout_append(&fd[1], args[i+1]))) break;
-	    else del_args(i, pnargs, args);
-	} else if (!strcmp(args[i], "2>")) {
-	    if(stderr_save == -1) stderr_save = dup(STDERR_FILENO);
-	    if (-1 == (rel = redirect_stderr(&fd[2], args[i+1]))) break;
-	    else del_args(i, pnargs, args);
-	} else {
-	    ++i;
+    int i, rel = 0;
+
+    for (i = 0; i < n && rel != -1; i++) {
+	if (save && redirs[i].fd == REDIR_OUT_ERR) {
+	    save_fd(STDOUT_FILENO);
+	    save_fd(STDERR_FILENO);
+	} else if (save) {
+	    save_fd(redirs[i].fd);
 	}
+	rel = redirect_fd(&redirs[i]);
     }
     return (rel == -1);
 }
 
-/* Retore stdin, stdout and/or stderr 
- * after redirection is done. */
+/* Turn redirections into file actions of a process to be 
+ * spawned, so that hsh's own stdio is never touched. Duplicating
+ * a descriptor of hsh's own closes it first, so that spawning fails
+ * with EBADF.
+ * @actions: file actions of the process
+ * @redirs: redirections of the process
+ * @n: # of redirections */
+void io_spawn_actions(posix_spawn_file_actions_t *actions, REDIR *redirs, int n)
+{
+    int i, fd;
+
+    for (i = 0; i < n; i++) {
+	fd = (redirs[i].fd == REDIR_OUT_ERR) ? STDOUT_FILENO : redirs[i].fd;
+	if (redirs[i].dup != -1 && internal_fd(redirs[i].dup)
+		&& !redirected(redirs, i, redirs[i].dup))
+	    posix_spawn_file_actions_addclose(actions, redirs[i].dup);
+	if (redirs[i].dup != -1)
+	    posix_spawn_file_actions_adddup2(actions, redirs[i].dup, fd);
+	else
+	    posix_spawn_file_actions_addopen(actions, fd, 
+		    redirs[i].path, redirs[i].flags, 0666);
+	if (redirs[i].fd == REDIR_OUT_ERR)
+	    posix_spawn_file_actions_adddup2(actions, STDOUT_FILENO, STDERR_FILENO);
+    }
+}
+
+/* Find out which redirection made spawning a process fail and
+ * report it the same way io_apply() would have done.
+ * @redirs: redirections of the process
+ * @n: # of redirections
+ * @return: 1 if a failing redirection was found otherwise 0 */
+int io_diagnose(REDIR *redirs, int n)
+{
+    int i, fd;
+
+    for (i = 0; i < n; i++) {
+	if (redirs[i].dup != -1) {
+	    if ((-1 == fcntl(redirs[i].dup, F_GETFD) || internal_fd(redirs[i].dup))
+		    && !redirected(redirs, i, redirs[i].dup)) {
+		fprintf(stderr, "-hsh: %d: %s\n", redirs[i].dup, strerror(EBADF));
+		return 1;
+	    }
+	} else if (-1 == (fd = open(redirs[i].path, redirs[i].flags & ~O_TRUNC, 0666))) {
+	    fprintf(stderr, "-hsh: %s: %s\n", redirs[i].path, strerror(errno));
+	    return 1;
+	} else {
+	    close(fd);
+	}
+    }
+    return 0;
+}
+
+/* Restore the descriptors of hsh io_apply() saved, and close 
+ * the copies, after a builtin is done. */
 void restore_stdio(void)
 {
-    if (stdin_save != -1)
-	dup2(stdin_save, STDIN_FILENO);
-    if (stdout_save != -1)
-	dup2(stdout_save, STDOUT_FILENO);
-    if (stderr_save != -1)
-	dup2(stderr_save, STDERR_FILENO);
+    while (n_saved > 0) {
+	n_saved--;
+	if (saved_copy[n_saved] == -1) {
+	    close(saved_fd[n_saved]);
+	} else {
+	    dup2(saved_copy[n_saved], saved_fd[n_saved]);
+	    close(saved_copy[n_saved]);
+	}
+    }
 }
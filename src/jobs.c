@@ -0,0 +1,816 @@
+/**
+ * This file implements jobs and job control for Hank Shell.
+ * Every pipeline hsh launches is a job: its processes are kept in
+ * the job table until they are done. A SIGCHLD handler reaps the
+ * processes of the table asynchronously; the foreground job is
+ * waited for with sigsuspend(2), background jobs ('cmd &') are not.
+ * When hsh is interactive each job runs in its own process group,
+ * which is handed the terminal while it is in the foreground.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* states of a process */
+#define PS_RUNNING 0
+#define PS_STOPPED 1
+#define PS_DONE	   2
+
+/* the job table, in order of creation; the last job is the
+ * current job ('%+'), the one before it the previous job ('%-') */
+static JOB **job_table = (JOB **) NULL;
+static int n_jobs = 0, job_cap = 0;
+
+/* non-zero if hsh does job control: interactive on a terminal */
+static int job_control = 0;
+static pid_t shell_pgid = 0;
+
+/* how long a foreground job is waited for between pipe_adapt()s */
+static const struct timespec pipe_tick = { 0, PIPE_TICK_MS * 1000000L };
+
+/* signal mask of hsh outside job launching; SIGCHLD unblocked */
+static sigset_t shell_mask;
+
+/* signals hsh ignores when doing job control; reset in children */
+static const int job_signals[] = { SIGTSTP, SIGTTIN, SIGTTOU, SIGQUIT };
+#define N_JOB_SIGNALS (int) (sizeof(job_signals) / sizeof(job_signals[0]))
+
+/* signal names understood by 'kill' */
+static const struct { const char *name; int num; } sig_names[] = {
+    { "HUP", SIGHUP },   { "INT", SIGINT },   { "QUIT", SIGQUIT },
+    { "KILL", SIGKILL }, { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 },
+    { "PIPE", SIGPIPE }, { "ALRM", SIGALRM }, { "TERM", SIGTERM },
+    { "CHLD", SIGCHLD }, { "CONT", SIGCONT }, { "STOP", SIGSTOP },
+    { "TSTP", SIGTSTP }, { "TTIN", SIGTTIN }, { "TTOU", SIGTTOU },
+    { (char *) NULL, 0 }
+};
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	 Job Helper Functions			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Block or unblock SIGCHLD; the job table must not be changed
+ * while the SIGCHLD handler may run. */
+static void block_sigchld(int block)
+{
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, NULL);
+}
+
+/* Record a change of state of a process.
+ * @p: the process
+ * @wstatus: status value filled in by wait4() */
+static void update_process(PROCESS *p, int wstatus)
+{
+    if (WIFSTOPPED(wstatus)) {
+	p->state = PS_STOPPED;
+	p->status = 128 + WSTOPSIG(wstatus);
+    } else if (WIFCONTINUED(wstatus)) {
+	p->state = PS_RUNNING;
+    } else {
+	p->state = PS_DONE;
+	p->status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus)
+				       : 128 + WTERMSIG(wstatus);
+	time_stop(p);
+    }
+}
+
+/* Reap a process of the job table if its state has changed;
+ * its resource usage is collected as well.
+ * @p: the process
+ * @return: non-zero if a change was collected */
+static int reap_process(PROCESS *p)
+{
+    int wstatus;
+
+    if (p->pid <= 0 || p->state == PS_DONE || p->pid != 
+	    wait4(p->pid, &wstatus, WNOHANG | WUNTRACED | WCONTINUED, &p->ru))
+	return 0;
+    update_process(p, wstatus);
+    return 1;
+}
+
+/* SIGCHLD handler: reap the processes of the job table. Other
+ * children of hsh, e.g. of command substitution, are left alone.
+ * waitid(WNOWAIT) tells which child changed state, so a long
+ * pipeline costs one waitpid() per process, not per signal. */
+static void sigchld_handler(int sig)
+{
+    int i, j, found, saved_errno = errno;
+    siginfo_t info;
+
+    (void) sig;
+    while (1) {
+	info.si_pid = 0;
+	if (-1 == waitid(P_ALL, 0, &info, 
+		    WEXITED | WSTOPPED | WCONTINUED | WNOHANG | WNOWAIT) || !info.si_pid)
+	    break;
+
+	for (i = found = 0; !found && i < n_jobs; i++)
+	    for (j = 0; !found && j < job_table[i]->n_ps; j++)
+		if (job_table[i]->ps[j].pid == info.si_pid)
+		    found = reap_process(&job_table[i]->ps[j]);
+
+	if (!found) {	/* not ours: check the whole table instead */
+	    for (i = 0; i < n_jobs; i++)
+		for (j = 0; j < job_table[i]->n_ps; j++)
+		    reap_process(&job_table[i]->ps[j]);
+	    break;
+	}
+    }
+    errno = saved_errno;
+}
+
+/* Check whether a job has processes that are neither done nor
+ * stopped. */
+static int job_is_running(JOB *job)
+{
+    int i;
+    for (i = 0; i < job->n_ps; i++)
+	if (job->ps[i].state == PS_RUNNING)
+	    return 1;
+    return 0;
+}
+
+/* Check whether every process of a job is done. */
+static int job_is_done(JOB *job)
+{
+    int i;
+    for (i = 0; i < job->n_ps; i++)
+	if (job->ps[i].state != PS_DONE)
+	    return 0;
+    return 1;
+}
+
+/* Remove a job from the job table and free it.
+ * SIGCHLD must be blocked. */
+static void remove_job(JOB *job)
+{
+    int i;
+
+    for (i = 0; i < n_jobs && job_table[i] != job; i++)
+	;
+    if (i == n_jobs)
+	return;
+    memmove(&job_table[i], &job_table[i+1], (n_jobs - i - 1) * sizeof(JOB *));
+    n_jobs--;
+    if (job->timed && job_is_done(job))
+	time_report(job);
+    free(job);
+}
+
+/* Find the current job or the one before it; jobs being waited
+ * for in the foreground don't count.
+ * @k: 0 for the current job ('%+'), 1 for the previous ('%-')
+ * @return: the job; NULL if there is none */
+static JOB *recent_job(int k)
+{
+    int i;
+
+    for (i = n_jobs - 1; i >= 0; i--)
+	if (!job_table[i]->foreground && !k--)
+	    return job_table[i];
+    return (JOB *) NULL;
+}
+
+/* Print a line describing a job, as 'jobs' does.
+ * @job: the job
+ * @verbose: non-zero to print process ids too */
+static void print_job(JOB *job, int verbose)
+{
+    int i;
+    char state[32];
+
+    if (job_is_done(job)) {
+	if (job->ps[job->n_ps-1].status)
+	    snprintf(state, sizeof(state), "Exit %d", job->ps[job->n_ps-1].status);
+	else
+	    strcpy(state, "Done");
+    } else if (job_is_running(job)) {
+	strcpy(state, "Running");
+    } else {
+	strcpy(state, "Stopped");
+    }
+
+    printf("[%d]%c  ", job->id, (job == recent_job(0)) ? '+' :
+	    (job == recent_job(1)) ? '-' : ' ');
+    if (verbose)
+	for (i = 0; i < job->n_ps; i++)
+	    if (job->ps[i].pid > 0)
+		printf("%d ", (int) job->ps[i].pid);
+    printf("%-24s%s%s\n", state, job->cmd,
+	    (job->foreground || !job_is_running(job)) ? "" : " &");
+}
+
+/* Send a signal to every process of a job. */
+static int signal_job(JOB *job, int sig)
+{
+    int i, rel = 0;
+
+    if (job_control)
+	return kill(-job->pgid, sig);
+    for (i = 0; i < job->n_ps; i++)
+	if (job->ps[i].pid > 0 && job->ps[i].state != PS_DONE)
+	    rel |= kill(job->ps[i].pid, sig);
+    return rel;
+}
+
+/* Resume a stopped job.
+ * SIGCHLD must be blocked. */
+static void continue_job(JOB *job)
+{
+    int i;
+
+    for (i = 0; i < job->n_ps; i++)
+	if (job->ps[i].state == PS_STOPPED)
+	    job->ps[i].state = PS_RUNNING;
+    signal_job(job, SIGCONT);
+}
+
+/* Check whether a job was stopped for using the terminal before
+ * hsh handed the terminal to it. */
+static int stopped_for_tty(JOB *job)
+{
+    int i;
+
+    for (i = 0; i < job->n_ps; i++)
+	if (job->ps[i].state == PS_STOPPED && 
+	    job->ps[i].status != 128 + SIGTTIN && job->ps[i].status != 128 + SIGTTOU)
+	    return 0;
+    return !job_is_done(job);
+}
+
+/* Wait until a job is no longer running, with the terminal handed
+ * to it when job control is on. SIGCHLD must be blocked.
+ * @job: the job */
+static void wait_job(JOB *job)
+{
+    if (job_control && job->pgid)
+	tcsetpgrp(STDIN_FILENO, job->pgid);
+
+    while (1) {
+	while (job_is_running(job)) {
+	    if (pipe_adapt())	/* look at its pipes again in a tick */
+		ppoll(NULL, 0, &pipe_tick, &shell_mask);
+	    else
+		sigsuspend(&shell_mask);
+	}
+	if (!job_control || !stopped_for_tty(job))
+	    break;
+	continue_job(job);	/* it is in the foreground now */
+    }
+
+    if (job_control && job->pgid)
+	tcsetpgrp(STDIN_FILENO, shell_pgid);
+}
+
+/* Wait for a job in the foreground and set exit status from it;
+ * the job is removed unless it was stopped. SIGCHLD must be
+ * blocked.
+ * @job: the job */
+static void wait_foreground(JOB *job)
+{
+    int i;
+    int *status = (int *) arena_alloc(job->n_ps * sizeof(int));
+
+    job->foreground = 1;
+    wait_job(job);
+
+    for (i = 0; i < job->n_ps; i++)
+	status[i] = job->ps[i].status;
+    last_status = status[job->n_ps-1];
+    set_pipe_status(status, job->n_ps);
+
+    if (job_is_done(job)) {
+	remove_job(job);
+    } else {			/* stopped: now a background job */
+	job->foreground = 0;
+	putchar('\n');
+	print_job(job, 0);
+    }
+}
+
+/* Find the job a job specification refers to.
+ * @spec: '%N', '%+', '%%', '%-', '%string' or NULL for the
+ * 	  current job
+ * @name: name of the builtin, for error messages
+ * @return: the job; NULL if there is no such job */
+static JOB *find_job(const char *spec, const char *name)
+{
+    int i, id;
+    char *end;
+    JOB *job;
+
+    if (!spec || !strcmp(spec, "%") || !strcmp(spec, "%%") || !strcmp(spec, "%+")) {
+	if ((job = recent_job(0)))
+	    return job;
+	fprintf(stderr, "-hsh: %s: current: no such job\n", name);
+	return (JOB *) NULL;
+    }
+
+    if (!strcmp(spec, "%-")) {
+	if ((job = recent_job(1)))
+	    return job;
+    } else if (spec[0] == '%') {
+	id = strtol(spec + 1, &end, 10);
+	for (i = n_jobs - 1; i >= 0; i--)
+	    if (!job_table[i]->foreground &&
+		((!*end && job_table[i]->id == id) ||
+		 (*end && !strncmp(job_table[i]->cmd, spec + 1, strlen(spec + 1)))))
+		return job_table[i];
+    }
+    fprintf(stderr, "-hsh: %s: %s: no such job\n", name, spec);
+    return (JOB *) NULL;
+}
+
+/* Find the job a process belongs to.
+ * @pid: process id
+ * @idx: set to the index of the process in the job
+ * @return: the job; NULL if pid is not in the job table */
+static JOB *find_pid(pid_t pid, int *idx)
+{
+    int i, j;
+
+    for (i = 0; i < n_jobs; i++)
+	for (j = 0; j < job_table[i]->n_ps; j++)
+	    if (job_table[i]->ps[j].pid == pid) {
+		*idx = j;
+		return job_table[i];
+	    }
+    return (JOB *) NULL;
+}
+
+/* Move a job to the end of the job table, making it current. */
+static void make_current(JOB *job)
+{
+    int i;
+
+    for (i = 0; i < n_jobs && job_table[i] != job; i++)
+	;
+    memmove(&job_table[i], &job_table[i+1], (n_jobs - i - 1) * sizeof(JOB *));
+    job_table[n_jobs-1] = job;
+}
+
+/* Parse a signal name or number as given to 'kill'.
+ * @s: e.g. "TERM", "SIGTERM" or "15"
+ * @return: the signal number; -1 if unknown */
+static int parse_signal(const char *s)
+{
+    int i;
+    char *end;
+
+    if (isdigit((unsigned char) *s)) {
+	i = strtol(s, &end, 10);
+	return (*end || i >= NSIG) ? -1 : i;
+    }
+    if (!strncasecmp(s, "SIG", 3))
+	s += 3;
+    for (i = 0; sig_names[i].name; i++)
+	if (!strcasecmp(s, sig_names[i].name))
+	    return sig_names[i].num;
+    return -1;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    Job Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Install the SIGCHLD handler. */
+void jobs_init(void)
+{
+    struct sigaction sa;
+
+    sigprocmask(SIG_SETMASK, NULL, &shell_mask);
+    sigdelset(&shell_mask, SIGCHLD);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigchld_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+}
+
+/* Turn on job control if hsh runs on a terminal: put hsh in its
+ * own process group and take the terminal. */
+void jobs_enable_control(void)
+{
+    int i;
+
+    if (!isatty(STDIN_FILENO))
+	return;
+
+    /* wait until we are in the foreground */
+    while (tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp()))
+	kill(-shell_pgid, SIGTTIN);
+
+    for (i = 0; i < N_JOB_SIGNALS; i++)
+	signal(job_signals[i], SIG_IGN);
+
+    shell_pgid = getpid();
+    if (getpgrp() != shell_pgid && -1 == setpgid(shell_pgid, shell_pgid)) {
+	perror("setpgid");
+	return;
+    }
+    tcsetpgrp(STDIN_FILENO, shell_pgid);
+    job_control = 1;
+}
+
+/* Check whether hsh does job control. */
+int jobs_control(void)
+{
+    return job_control;
+}
+
+/* Create a job for a pipeline about to be launched. SIGCHLD stays
+ * blocked until job_end(), so no process can be reaped before it
+ * has been added to the job.
+ * @cmd: command line of the job
+ * @n_ps: # of processes of the job
+ * @background: non-zero if the job runs in the background
+ * @return: the job */
+JOB *job_begin(const char *cmd, int n_ps, int background)
+{
+    int id = 0, i;
+    size_t len = strlen(cmd);
+    JOB *job;
+
+    /* the command as shown by 'jobs', without a trailing '&' */
+    while (len && (isspace((unsigned char) cmd[len-1]) || cmd[len-1] == '&'))
+	len--;
+    while (len && isspace((unsigned char) *cmd))
+	cmd++, len--;
+
+    if (!(job = (JOB *) malloc(sizeof(JOB) + n_ps * sizeof(PROCESS) + len + 1)))
+	die_with_error("malloc");
+    job->ps = (PROCESS *) (job + 1);
+    job->cmd = (char *) (job->ps + n_ps);
+    memcpy(job->cmd, cmd, len);
+    job->cmd[len] = '\0';
+    job->n_ps = 0;
+    job->pgid = 0;
+    job->foreground = !background;
+    job->timed = time_take();
+
+    block_sigchld(1);
+    if (n_jobs == job_cap) {
+	job_cap = job_cap ? 2 * job_cap : 16;
+	if (!(job_table = (JOB **) realloc(job_table, job_cap * sizeof(JOB *))))
+	    die_with_error("realloc");
+    }
+    for (i = 0; i < n_jobs; i++)
+	if (job_table[i]->id > id)
+	    id = job_table[i]->id;
+    job->id = id + 1;
+    job_table[n_jobs++] = job;
+    return job;
+}
+
+/* Add a launched process to a job. The first process leads the
+ * process group of the job.
+ * @job: the job
+ * @pid: process id; -1 if the process failed to launch
+ * @status: exit status of a process which failed to launch */
+void job_add_process(JOB *job, pid_t pid, int status)
+{
+    PROCESS *p = &job->ps[job->n_ps++];
+
+    p->pid = pid;
+    p->status = status;
+    p->state = (pid > 0) ? PS_RUNNING : PS_DONE;
+    time_start(p);
+    if (pid <= 0)
+	return;
+
+    if (!job_control) {
+	job->pgid = job->pgid ? job->pgid : pid;
+	return;
+    }
+
+    /* also done in the child; whoever is first wins */
+    if (!job->pgid) {
+	job->pgid = pid;
+	setpgid(pid, pid);
+	if (job->foreground)	/* hand over the terminal right away */
+	    tcsetpgrp(STDIN_FILENO, pid);
+    } else {
+	setpgid(pid, job->pgid);
+    }
+}
+
+/* Finish launching a job: wait for it if it runs in the foreground,
+ * otherwise report its job number.
+ * @job: the job
+ * @background: non-zero if the job runs in the background */
+void job_end(JOB *job, int background)
+{
+    if (!background) {
+	wait_foreground(job);
+    } else if (job->pgid) {
+	if (job_control)
+	    fprintf(stderr, "[%d] %d\n", job->id, (int) job->ps[job->n_ps-1].pid);
+	last_status = 0;
+    } else {			/* nothing was launched */
+	last_status = job->ps[job->n_ps-1].status;
+	remove_job(job);
+    }
+    block_sigchld(0);
+}
+
+/* Set up spawn attributes of a process of a job: its process group
+ * and the signal state hsh would otherwise pass on.
+ * @attr: initialized spawn attributes
+ * @job: the job; NULL for none */
+void job_spawn_attr(posix_spawnattr_t *attr, JOB *job)
+{
+    int i;
+    short flags = POSIX_SPAWN_SETSIGMASK;
+    sigset_t dfl;
+
+    posix_spawnattr_setsigmask(attr, &shell_mask);
+    if (job_control && job) {
+	flags |= POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF;
+	posix_spawnattr_setpgroup(attr, job->pgid);
+	sigemptyset(&dfl);
+	for (i = 0; i < N_JOB_SIGNALS; i++)
+	    sigaddset(&dfl, job_signals[i]);
+	posix_spawnattr_setsigdefault(attr, &dfl);
+    }
+    posix_spawnattr_setflags(attr, flags);
+}
+
+/* Set up a forked child of hsh the way job_spawn_attr() sets up a
+ * spawned one.
+ * @job: the job the child belongs to; NULL if none */
+void job_child_setup(JOB *job)
+{
+    int i;
+
+    if (job_control && job) {
+	setpgid(0, job->pgid);
+	for (i = 0; i < N_JOB_SIGNALS; i++)
+	    signal(job_signals[i], SIG_DFL);
+    }
+    sigprocmask(SIG_SETMASK, &shell_mask, NULL);
+}
+
+/* Report background jobs which are done or stopped since the last
+ * report and remove those done; reports are only printed when hsh
+ * is interactive. */
+void jobs_notify(void)
+{
+    int i;
+    JOB *job;
+
+    /* nothing to report; the SIGCHLD handler never changes n_jobs,
+     * so an idle Enter costs no sigprocmask */
+    if (!n_jobs)
+	return;
+    block_sigchld(1);
+    for (i = 0; i < n_jobs; ) {
+	job = job_table[i];
+	if (!job->foreground && job_is_done(job)) {
+	    if (job_control)
+		print_job(job, 0);
+	    remove_job(job);
+	    continue;
+	}
+	i++;
+    }
+    block_sigchld(0);
+}
+
+/* Free the job table; processes still running are left alone. */
+void jobs_clean(void)
+{
+    block_sigchld(1);
+    while (n_jobs)
+	free(job_table[--n_jobs]);
+    free(job_table);
+    job_table = (JOB **) NULL;
+    job_cap = 0;
+    block_sigchld(0);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	 Job Control Builtins			     //
+// 	     	 						     //
+//===================================================================//
+
+/* jobs [-l|-p]: list the jobs */
+int builtin_jobs(int nargs, char **args)
+{
+    int i, opt_l = 0, opt_p = 0;
+
+    for (i = 1; i < nargs && args[i][0] == '-'; i++) {
+	if (!strcmp(args[i], "-l"))
+	    opt_l = 1;
+	else if (!strcmp(args[i], "-p"))
+	    opt_p = 1;
+	else {
+	    fprintf(stderr, "-hsh: %s: %s: invalid option\n", args[0], args[i]);
+	    return 2;
+	}
+    }
+
+    block_sigchld(1);
+    for (i = 0; i < n_jobs; i++) {
+	if (job_table[i]->foreground)
+	    continue;
+	if (opt_p)
+	    printf("%d\n", (int) job_table[i]->pgid);
+	else
+	    print_job(job_table[i], opt_l);
+    }
+    block_sigchld(0);
+    return 0;
+}
+
+/* kill [-s sig | -sig] pid|%job ...: send a signal
+ * kill -l: list signal names */
+int builtin_kill(int nargs, char **args)
+{
+    int i = 1, sig = SIGTERM, rel = 0;
+    pid_t pid;
+    char *end;
+    JOB *job;
+
+    if (nargs > 1 && !strcmp(args[1], "-l")) {
+	for (i = 0; sig_names[i].name; i++)
+	    printf("%2d) SIG%s\n", sig_names[i].num, sig_names[i].name);
+	return 0;
+    }
+
+    if (nargs > 2 && !strcmp(args[1], "-s")) {
+	sig = parse_signal(args[2]);
+	i = 3;
+    } else if (nargs > 1 && args[1][0] == '-' && args[1][1]) {
+	sig = parse_signal(args[1] + 1);
+	i = 2;
+    }
+    if (sig < 0) {
+	fprintf(stderr, "-hsh: %s: %s: invalid signal specification\n",
+		args[0], args[i-1]);
+	return 1;
+    }
+    if (i >= nargs) {
+	fprintf(stderr, "-hsh: %s: usage: kill [-s sigspec | -sigspec] pid | %%job ...\n",
+		args[0]);
+	return 2;
+    }
+
+    block_sigchld(1);
+    for (; i < nargs; i++) {
+	if (args[i][0] == '%') {
+	    if (!(job = find_job(args[i], args[0])))
+		rel = 1;
+	    else if (-1 == signal_job(job, sig)) {
+		fprintf(stderr, "-hsh: %s: %s: %s\n", args[0], args[i], strerror(errno));
+		rel = 1;
+	    }
+	    continue;
+	}
+	pid = strtol(args[i], &end, 10);
+	if (*end || !*args[i]) {
+	    fprintf(stderr, "-hsh: %s: %s: arguments must be process or job IDs\n",
+		    args[0], args[i]);
+	    rel = 1;
+	} else if (-1 == kill(pid, sig)) {
+	    fprintf(stderr, "-hsh: %s: (%s) - %s\n", args[0], args[i], strerror(errno));
+	    rel = 1;
+	}
+    }
+    block_sigchld(0);
+    return rel;
+}
+
+/* Wait until a background job is no longer running: done, or
+ * stopped, which it may stay forever. A job done is removed, a
+ * stopped one is reported and kept. SIGCHLD must be blocked.
+ * @job: the job
+ * @idx: index of the process waited for; -1 for the whole job
+ * @return: exit status of the process, or of the last one */
+static int wait_background(JOB *job, int idx)
+{
+    int rel;
+
+    while (idx == -1 ? job_is_running(job) : job->ps[idx].state == PS_RUNNING)
+	sigsuspend(&shell_mask);
+    rel = job->ps[idx == -1 ? job->n_ps - 1 : idx].status;
+
+    if (job_is_done(job))
+	remove_job(job);
+    else if (!job_is_running(job) && job_control)
+	print_job(job, 0);
+    return rel;
+}
+
+/* wait [pid|%job ...]: wait for background jobs to be done or
+ * stopped
+ * @return: exit status of the last job or process waited for */
+int builtin_wait(int nargs, char **args)
+{
+    int i, idx, rel = 0;
+    pid_t pid;
+    char *end;
+    JOB *job;
+
+    block_sigchld(1);
+
+    /* no arguments: wait for every job, from the last one, so that
+     * removing a job moves none still to be waited for */
+    if (nargs == 1) {
+	for (i = n_jobs - 1; i >= 0; i--)
+	    if (!job_table[i]->foreground)
+		wait_background(job_table[i], -1);
+	block_sigchld(0);
+	return 0;
+    }
+
+    for (i = 1; i < nargs; i++) {
+	if (args[i][0] == '%') {
+	    if (!(job = find_job(args[i], args[0]))) {
+		rel = 127;
+		continue;
+	    }
+	    idx = -1;
+	} else {
+	    pid = strtol(args[i], &end, 10);
+	    if (*end || !(job = find_pid(pid, &idx))) {
+		fprintf(stderr, "-hsh: %s: pid %s is not a child of this shell\n",
+			args[0], args[i]);
+		rel = 127;
+		continue;
+	    }
+	}
+	rel = wait_background(job, idx);
+    }
+
+    block_sigchld(0);
+    return rel;
+}
+
+/* fg [%job]: continue a job in the foreground */
+int builtin_fg(int nargs, char **args)
+{
+    JOB *job;
+
+    if (!job_control) {
+	fprintf(stderr, "-hsh: %s: no job control\n", args[0]);
+	return 1;
+    }
+
+    block_sigchld(1);
+    if (!(job = find_job(nargs > 1 ? args[1] : NULL, args[0]))) {
+	block_sigchld(0);
+	return 1;
+    }
+
+    printf("%s\n", job->cmd);
+    fflush(stdout);
+    make_current(job);
+    continue_job(job);
+    wait_foreground(job);
+    block_sigchld(0);
+    return last_status;
+}
+
+/* bg [%job]: continue a stopped job in the background */
+int builtin_bg(int nargs, char **args)
+{
+    JOB *job;
+
+    if (!job_control) {
+	fprintf(stderr, "-hsh: %s: no job control\n", args[0]);
+	return 1;
+    }
+
+    block_sigchld(1);
+    if (!(job = find_job(nargs > 1 ? args[1] : NULL, args[0]))) {
+	block_sigchld(0);
+	return 1;
+    }
+
+    job->foreground = 0;
+    make_current(job);
+    continue_job(job);
+    printf("[%d]+ %s &\n", job->id, job->cmd);
+    block_sigchld(0);
+    return 0;
+}
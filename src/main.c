@@ -1,20 +1,60 @@
 #include "hsh.h"
 
-int do_main(void)
+extern int last_status;
+
+/* Print usage message.
+ * @prog: program name */
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-t] [-c command | script]\n", prog);
+}
+
+int do_main(int argc, char **argv)
 {
+	int status;
+
 	/* initialize shell */
 	init_shell();
+
+	/* -t: trace the phases of running command lines */
+	if (argc >= 2 && !strcmp(argv[1], "-t")) {
+		trace_enable(1);
+		argv[1] = argv[0];
+		argc--, argv++;
+	}
 	
-	/* execute commands from command line */
-	execute_line();
+	if (argc >= 2 && !strcmp(argv[1], "-c")) {
+		/* execute commands given on command line */
+		if (argc < 3) {
+			fprintf(stderr, "-hsh: -c: option requires an argument\n");
+			usage(argv[0]);
+			status = 2;
+		} else {
+			status = execute_string(argv[2]);
+		}
+	} else if (argc >= 2 && argv[1][0] == '-' && argv[1][1]) {
+		fprintf(stderr, "-hsh: %s: invalid option\n", argv[1]);
+		usage(argv[0]);
+		status = 2;
+	} else if (argc >= 2) {
+		/* execute commands from a script file */
+		status = execute_file(argv[1]);
+	} else if (!isatty(STDIN_FILENO)) {
+		/* execute commands piped into stdin */
+		status = execute_fd(STDIN_FILENO);
+	} else {
+		/* execute commands from command line */
+		execute_line();
+		status = last_status;
+	}
 
 	/* clean up hsh memory*/
 	clean_shell();
 
-	return 0;
+	return status;
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
-	return do_main();
+	return do_main(argc, argv);
 }
@@ -0,0 +1,535 @@
+/**
+ * This file is the parallel executor of Hank Shell: the 'parallel'
+ * builtin runs a command template once per argument over a bounded
+ * pool of children. Completions are waited for with pidfds and
+ * poll(2) instead of busy waiting; the standard output of every job
+ * is captured through a pipe and written out in argument order, so
+ * the outputs of jobs never interleave.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern struct List paths_list;
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* separates the command template from its arguments */
+#define ARGS_SEP ":::"
+
+/* replaced by the argument in the command template */
+#define ARG_MARK "{}"
+
+/* A job of the parallel builtin */
+typedef struct {
+    const char *arg;	/* the argument the job runs with */
+    pid_t pid;		/* -1 if the job could not be started */
+    int pidfd;		/* -1 if pidfds are not supported */
+    int out;		/* captured stdout; -1 once at end of file */
+    int exited;		/* the process has been reaped */
+    int status;		/* exit status of the job */
+    char *buf;		/* output waiting for its turn */
+    size_t len, cap;
+} PJOB;
+
+/* The command template: words and redirections of one job */
+typedef struct {
+    int argc;
+    char **argv;	/* words; ARG_MARK is replaced by the argument */
+    int n_redirs;
+    REDIR *redirs;	/* redirections of each job */
+    int append;		/* no ARG_MARK: the argument is appended */
+} TEMPLATE;
+
+static const char *usage = "parallel [-j N] cmd [arg ...] [::: arg ...]";
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    Parallel Executor Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Write a whole buffer, retrying on short writes.
+ * @fd: file descriptor to write to
+ * @buf: data to be written
+ * @len: # of bytes */
+static void write_all(int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len) {
+	if (-1 == (n = write(fd, buf, len))) {
+	    if (errno == EINTR)
+		continue;
+	    return;
+	}
+	buf += n;
+	len -= n;
+    }
+}
+
+/* Replace every ARG_MARK in a template word by the argument.
+ * @word: the template word
+ * @arg: the argument
+ * @return: the word itself if it has no mark, otherwise
+ * 	    a new word in the per-line arena */
+static char *subst_arg(char *word, const char *arg)
+{
+    char *mark, *res, *dst;
+    size_t n = 0, alen = strlen(arg);
+
+    for (mark = word; (mark = strstr(mark, ARG_MARK)); mark += 2)
+	n++;
+    if (!n)
+	return word;
+
+    dst = res = (char *) arena_alloc(strlen(word) + n * alen + 1);
+    while ((mark = strstr(word, ARG_MARK))) {
+	memcpy(dst, word, mark - word);
+	dst += mark - word;
+	memcpy(dst, arg, alen);
+	dst += alen;
+	word = mark + 2;
+    }
+    strcpy(dst, word);
+    return res;
+}
+
+/* Split the command template into words and redirections. The
+ * operators reach the builtin quoted, e.g. '>' out{} or '>out{}'.
+ * @argc: # of template words
+ * @argv: template words
+ * @tmpl: the template being filled in
+ * @return: 0 if no errors otherwise 1 */
+static int parse_template(int argc, char **argv, TEMPLATE *tmpl)
+{
+    int i, n;
+    REDIR *redir;
+
+    tmpl->argv = (char **) arena_alloc((argc + 2) * sizeof(char *));
+    tmpl->redirs = (REDIR *) arena_alloc(argc * sizeof(REDIR));
+    tmpl->argc = tmpl->n_redirs = 0;
+    tmpl->append = 1;
+
+    for (i = 0; i < argc; i++) {
+	if (strstr(argv[i], ARG_MARK))
+	    tmpl->append = 0;
+	redir = &tmpl->redirs[tmpl->n_redirs];
+	if (!(n = parse_redir(argv[i], redir))) {
+	    tmpl->argv[tmpl->argc++] = argv[i];
+	    continue;
+	}
+	if (redir->dup != -1) {		/* '2>&1' */
+	    if (argv[i][n]) {
+		fprintf(stderr, "-hsh: parallel: %s: bad redirection\n", argv[i]);
+		return 1;
+	    }
+	} else if (argv[i][n]) {	/* '>file' */
+	    redir->path = argv[i] + n;
+	} else if (i + 1 < argc) {	/* '>' file */
+	    redir->path = argv[++i];
+	    if (strstr(redir->path, ARG_MARK))
+		tmpl->append = 0;
+	} else {
+	    fprintf(stderr, "-hsh: parallel: %s: missing redirection target\n", argv[i]);
+	    return 1;
+	}
+	tmpl->n_redirs++;
+    }
+
+    if (!tmpl->argc) {
+	fprintf(stderr, "-hsh: parallel: usage: %s\n", usage);
+	return 1;
+    }
+    return 0;
+}
+
+/* Read the arguments of the jobs from stdin, one per line.
+ * @pn: # of arguments read
+ * @return: the argument list, in the per-line arena */
+static char **read_args(int *pn)
+{
+    char *data = (char *) NULL, *line, *nl, **list;
+    size_t len = 0, cap = 0;
+    ssize_t n;
+    int i, count = 0;
+
+    while (1) {
+	if (len + 4096 > cap) {
+	    cap = (len + 4096) * 2;
+	    if (!(data = (char *) realloc(data, cap)))
+		die_with_error("realloc");
+	}
+	if (-1 == (n = read(STDIN_FILENO, data + len, cap - len - 1))) {
+	    if (errno == EINTR)
+		continue;
+	    perror("-hsh: parallel: read");
+	    break;
+	}
+	if (!n)
+	    break;
+	len += n;
+    }
+    if (!data) {
+	*pn = 0;
+	return (char **) arena_alloc(sizeof(char *));
+    }
+    data[len] = '\0';
+
+    for (i = 0; i < (int) len; i++)
+	if (data[i] == '\n')
+	    count++;
+    list = (char **) arena_alloc((count + 2) * sizeof(char *));
+
+    for (i = 0, line = data; *line; line = nl + 1) {
+	if ((nl = strchr(line, '\n')))
+	    *nl = '\0';
+	if (*line)			/* empty lines are skipped */
+	    list[i++] = arena_strdup(line);
+	if (!nl)
+	    break;
+    }
+    free(data);
+    *pn = i;
+    return list;
+}
+
+/* Run a builtin job in a forked child.
+ * @argc: # of arguments
+ * @argv: argument list
+ * @redirs: redirections with the argument substituted
+ * @n_redirs: # of redirections
+ * @null: /dev/null, the job's stdin
+ * @out: write end of the job's output pipe
+ * @return: process id of the child; -1 on error */
+static pid_t fork_builtin(int argc, char **argv, REDIR *redirs, int n_redirs,
+	int null, int out)
+{
+    int rel;
+    pid_t pid;
+
+    if ((pid = fork()))
+	return pid;
+
+    job_child_setup((JOB *) NULL);
+    if (-1 == dup2(null, STDIN_FILENO) || -1 == dup2(out, STDOUT_FILENO))
+	_exit(EXIT_FAILURE);
+    if (io_apply(redirs, n_redirs, 0))
+	_exit(EXIT_FAILURE);
+    if (-1 == (rel = execute_builtin(argc, argv)))
+	_exit(last_status);
+    _exit(rel);
+}
+
+/* Start a job: substitute its argument into the template, resolve
+ * the command with find_cmd() and spawn it with stdin from /dev/null
+ * and stdout to a capture pipe, then apply the job's redirections.
+ * @job: the job; arg is set, everything else is filled in
+ * @tmpl: the command template
+ * @null: an open file descriptor of /dev/null */
+static void start_job(PJOB *job, TEMPLATE *tmpl, int null)
+{
+    int i, err, fds[2], argc = tmpl->argc;
+    char **argv = (char **) arena_alloc((argc + 2) * sizeof(char *));
+    char *cmd_path;
+    REDIR *redirs = (REDIR *) arena_alloc((tmpl->n_redirs + 1) * sizeof(REDIR));
+    posix_spawn_file_actions_t actions;
+
+    job->pid = -1;
+    job->pidfd = job->out = -1;
+    job->exited = 1;
+    job->status = 0;
+    job->buf = (char *) NULL;
+    job->len = job->cap = 0;
+
+    for (i = 0; i < argc; i++)
+	argv[i] = subst_arg(tmpl->argv[i], job->arg);
+    if (tmpl->append)
+	argv[argc++] = (char *) job->arg;
+    argv[argc] = (char *) NULL;
+
+    /* file names reach the builtin quoted, so they are expanded here,
+     * before the argument is put in: it is never expanded itself */
+    for (i = 0; i < tmpl->n_redirs; i++)
+	redirs[i] = tmpl->redirs[i];
+    if (expand_redirs(redirs, tmpl->n_redirs)) {
+	job->status = 1;
+	return;
+    }
+    for (i = 0; i < tmpl->n_redirs; i++)
+	if (redirs[i].path)
+	    redirs[i].path = subst_arg(redirs[i].path, job->arg);
+
+    if (-1 == pipe2(fds, O_CLOEXEC)) {
+	perror("-hsh: parallel: pipe");
+	job->status = 126;
+	return;
+    }
+
+    if (find_command(&argv, &argc)) {
+	if (-1 == (job->pid = fork_builtin(argc, argv, redirs, tmpl->n_redirs, null, fds[1]))) {
+	    perror("-hsh: parallel: fork");
+	    job->status = 126;
+	}
+    } else if (!(cmd_path = find_cmd(&paths_list, argv))) {
+	fprintf(stderr, "-hsh: %s: command not found\n", argv[0]);
+	job->status = 127;
+    } else {
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, null, STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+	io_spawn_actions(&actions, redirs, tmpl->n_redirs);
+	if (-1 == (job->pid = spawn_cmd(cmd_path, argv, &actions, (JOB *) NULL))) {
+	    err = errno;
+	    if (io_diagnose(redirs, tmpl->n_redirs)) {	/* a redirection failed */
+		job->status = 1;
+	    } else {
+		fprintf(stderr, "-hsh: %s: %s\n", argv[0], strerror(err));
+		job->status = (err == ENOENT) ? 127 : 126;
+	    }
+	}
+	posix_spawn_file_actions_destroy(&actions);
+    }
+
+    close(fds[1]);
+    if (job->pid == -1) {
+	close(fds[0]);
+	return;
+    }
+    job->out = fds[0];
+    job->exited = 0;
+    job->pidfd = (int) syscall(SYS_pidfd_open, job->pid, 0);
+}
+
+/* Reap the process of a job which has exited.
+ * @job: the job */
+static void reap_job(PJOB *job)
+{
+    int wstatus;
+
+    while (-1 == waitpid(job->pid, &wstatus, 0))
+	if (errno != EINTR)
+	    return;
+    if (WIFEXITED(wstatus))
+	job->status = WEXITSTATUS(wstatus);
+    else if (WIFSIGNALED(wstatus))
+	job->status = 128 + WTERMSIG(wstatus);
+    job->exited = 1;
+    if (job->pidfd != -1) {
+	close(job->pidfd);
+	job->pidfd = -1;
+    }
+}
+
+/* Stop capturing the output of a job.
+ * @job: the job
+ * @discard: non-zero to drop the output buffered so far */
+static void close_output(PJOB *job, int discard)
+{
+    close(job->out);
+    job->out = -1;
+    /* without a pidfd, end of output is the best sign of exit */
+    if (!job->exited && job->pidfd == -1)
+	reap_job(job);
+    if (discard) {
+	free(job->buf);
+	job->buf = (char *) NULL;
+	job->len = 0;
+    }
+}
+
+/* Read what a job has written so far. The job whose turn it is
+ * writes straight through; the others are buffered.
+ * @job: the job
+ * @head: non-zero if it is the job's turn to write */
+static void read_output(PJOB *job, int head)
+{
+    char chunk[16384];
+    ssize_t n;
+
+    if (-1 == (n = read(job->out, chunk, sizeof(chunk)))) {
+	if (errno != EINTR && errno != EAGAIN)
+	    close_output(job, 0);
+	return;
+    }
+    if (!n) {
+	close_output(job, 0);
+	return;
+    }
+
+    if (head) {
+	write_all(STDOUT_FILENO, chunk, n);
+	return;
+    }
+    if (job->len + n > job->cap) {
+	job->cap = (job->len + n) * 2;
+	if (!(job->buf = (char *) realloc(job->buf, job->cap)))
+	    die_with_error("realloc");
+    }
+    memcpy(job->buf + job->len, chunk, n);
+    job->len += n;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    Parallel Executor Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* builtin parallel: run cmd once for every argument given after
+ * ':::' (or read from stdin, one per line), at most N at a time;
+ * N defaults to the # of online CPUs. '{}' in cmd is replaced by
+ * the argument, which is appended if cmd has no '{}'. Outputs are
+ * written in argument order. On the first failing job no more jobs
+ * are started and those after it are killed.
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: exit status of the first failing job, 0 if none */
+int builtin_parallel(int nargs, char **args)
+{
+    int i, k, first = 1, sep, n_args, max_jobs = 0;
+    int null, running = 0, next = 0, turn = 0, failed = -1, nfds;
+    char **list, *end;
+    PJOB *jobs, *job;
+    TEMPLATE tmpl;
+    struct pollfd *fds;
+    int *owner, *slots;
+
+    if (first < nargs && !strncmp(args[first], "-j", 2)) {
+	if (args[first][2])
+	    max_jobs = (int) strtol(args[first] + 2, &end, 10);
+	else if (first + 1 < nargs)
+	    max_jobs = (int) strtol(args[++first], &end, 10);
+	else
+	    end = args[first];
+	if (*end || max_jobs < 1) {
+	    fprintf(stderr, "-hsh: parallel: invalid number of jobs\n");
+	    return 2;
+	}
+	first++;
+    }
+    if (!max_jobs && (max_jobs = (int) sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+	max_jobs = 1;
+
+    for (sep = first; sep < nargs && strcmp(args[sep], ARGS_SEP); sep++)
+	;
+    if (sep == first) {
+	fprintf(stderr, "-hsh: parallel: usage: %s\n", usage);
+	return 2;
+    }
+    if (parse_template(sep - first, args + first, &tmpl))
+	return 2;
+
+    if (sep < nargs) {
+	list = args + sep + 1;
+	n_args = nargs - sep - 1;
+    } else {
+	list = read_args(&n_args);
+    }
+    if (!n_args)
+	return 0;
+
+    if (-1 == (null = open("/dev/null", O_RDONLY | O_CLOEXEC))) {
+	perror("-hsh: parallel: /dev/null");
+	return 1;
+    }
+
+    jobs = (PJOB *) arena_alloc(n_args * sizeof(PJOB));
+    slots = (int *) arena_alloc(max_jobs * sizeof(int));
+    owner = (int *) arena_alloc(2 * max_jobs * sizeof(int));
+    fds = (struct pollfd *) arena_alloc(2 * max_jobs * sizeof(struct pollfd));
+    fflush(stdout);
+
+    while (1) {
+	/* fill the pool */
+	while (failed == -1 && running < max_jobs && next < n_args) {
+	    job = &jobs[next];
+	    job->arg = list[next];
+	    start_job(job, &tmpl, null);
+	    if (job->pid != -1)
+		slots[running++] = next;
+	    else if (job->status)
+		failed = next;
+	    next++;
+	}
+
+	/* write out the jobs whose turn it is, up to the failing one */
+	while (turn < next && (failed == -1 || turn <= failed)) {
+	    job = &jobs[turn];
+	    if (job->len) {		/* buffered before its turn */
+		write_all(STDOUT_FILENO, job->buf, job->len);
+		job->len = 0;
+	    }
+	    if (!job->exited || job->out != -1)
+		break;
+	    free(job->buf);
+	    job->buf = (char *) NULL;
+	    turn++;
+	}
+	if (!running)
+	    break;
+
+	/* wait for output or exits of running jobs */
+	for (i = nfds = 0; i < running; i++) {
+	    job = &jobs[slots[i]];
+	    if (job->out != -1) {
+		fds[nfds].fd = job->out;
+		fds[nfds].events = POLLIN;
+		owner[nfds++] = slots[i];
+	    }
+	    if (job->pidfd != -1) {
+		fds[nfds].fd = job->pidfd;
+		fds[nfds].events = POLLIN;
+		owner[nfds++] = slots[i];
+	    }
+	}
+	if (-1 == poll(fds, nfds, -1)) {
+	    if (errno == EINTR)
+		continue;
+	    perror("-hsh: parallel: poll");
+	    break;
+	}
+
+	for (i = 0; i < nfds; i++) {
+	    if (!fds[i].revents)
+		continue;
+	    job = &jobs[owner[i]];
+	    if (fds[i].fd == job->out)
+		read_output(job, owner[i] == turn);
+	    else if (fds[i].fd == job->pidfd)
+		reap_job(job);
+
+	    /* fail fast: kill the jobs after the first failing one */
+	    if (job->exited && job->status && (failed == -1 || owner[i] < failed)) {
+		failed = owner[i];
+		for (k = 0; k < running; k++) {
+		    if (slots[k] <= failed)
+			continue;
+		    if (!jobs[slots[k]].exited)
+			kill(jobs[slots[k]].pid, SIGTERM);
+		    if (jobs[slots[k]].out != -1)
+			close_output(&jobs[slots[k]], 1);
+		}
+	    }
+	}
+
+	/* a job leaves the pool once it exited and its output ended */
+	for (i = k = 0; i < running; i++) {
+	    job = &jobs[slots[i]];
+	    if (!job->exited || job->out != -1)
+		slots[k++] = slots[i];
+	}
+	running = k;
+    }
+
+    for (i = turn; i < next; i++)
+	free(jobs[i].buf);
+    close(null);
+    return (failed == -1) ? 0 : jobs[failed].status;
+}
@@ -0,0 +1,317 @@
+/**
+ * This file is the command line parser for Hank Shell.
+ * A single pass over the characters of a command line splits it
+ * into words and operators and builds its syntax tree:
+ * 	pipeline -> processes -> words + redirections
+ * The tree, including a copy of every word, lives in one contiguous
+ * block of the per-line arena.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* character classes of the lexer */
+#define C_WORD	0	/* part of a word */
+#define C_BLANK	1	/* word separator */
+#define C_OP	2	/* operator: '|', '&', '<' or '>' */
+#define C_QUOTE	3	/* quoting: '\'', '"', '`' or '\\' */
+#define C_END	4	/* end of line */
+
+static const unsigned char char_class[256] = {
+    ['\0'] = C_END,  [' '] = C_BLANK, ['\t'] = C_BLANK, ['\n'] = C_BLANK,
+    ['|'] = C_OP,    ['&'] = C_OP,    ['<'] = C_OP,    ['>'] = C_OP,
+    ['\''] = C_QUOTE, ['"'] = C_QUOTE, ['`'] = C_QUOTE, ['\\'] = C_QUOTE,
+};
+
+#define CLASS(c) (char_class[(unsigned char)(c)])
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Parser Helper Functions			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Report a syntax error.
+ * @token: the unexpected token
+ * @return: always NULL */
+static PIPELINE *syntax_error(const char *token)
+{
+    fprintf(stderr, "-hsh: syntax error near unexpected token '%s'\n", token);
+    return (PIPELINE *) NULL;
+}
+
+/* Allocate the buffer holding the syntax tree of a line of len 
+ * characters. A line has at most (len+1)/2 words, and no more 
+ * processes or redirections than words.
+ * @len: length of the command line
+ * @pmax: max # of words, processes or redirections
+ * @return: the tree buffer, from the per-line arena */
+static char *alloc_tree(size_t len, size_t *pmax)
+{
+    size_t max = (len + 1) / 2 + 2;
+
+    *pmax = max;
+    return (char *) arena_alloc(sizeof(PIPELINE) 
+	    + max * (sizeof(PS_INFO) + sizeof(REDIR))
+	    + 2 * max * sizeof(char *) + len + max);
+}
+
+/* Copy a word into the tree buffer, honouring quotes, backslashes
+ * and $(...); quote characters are kept for expand_words().
+ * @p: the first character of the word
+ * @pdst: pointer to where the word is copied to; advanced
+ * 	  past the terminating null character
+ * @return: pointer to the character ending the word;
+ * 	    NULL on unterminated quote */
+static const char *scan_word(const char *p, char **pdst)
+{
+    char q, *dst = *pdst;
+    int depth;
+
+    while (1) {
+	switch (CLASS(*p)) {
+	    case C_WORD:
+		if (*p == '$' && p[1] == '(') {	/* command substitution */
+		    *dst++ = *p++;
+		    for (depth = 0; *p != ')' || --depth; ) {
+			if (!*p)
+			    return (const char *) NULL;
+			if (*p == '(')
+			    depth++;
+			*dst++ = *p++;
+		    }
+		}
+		*dst++ = *p++;
+		break;
+	    case C_QUOTE:
+		if (*p == '\\') {
+		    *dst++ = *p++;
+		    if (*p)
+			*dst++ = *p++;
+		    break;
+		}
+		for (q = *dst++ = *p++; *p != q; ) {
+		    if (!*p)
+			return (const char *) NULL;
+		    if (q != '\'' && *p == '\\' && p[1])
+			*dst++ = *p++;
+		    *dst++ = *p++;
+		}
+		*dst++ = *p++;
+		break;
+	    default:
+		*dst++ = '\0';
+		*pdst = dst;
+		return p;
+	}
+    }
+}
+
+/* Recognize the sharding of the stage after a pipe, 'N8' or 'N8o'
+ * right after the '|'; a word which merely starts like it, such as
+ * 'N8x', is a command.
+ * @p: the character after the '|'
+ * @ps: shards and shard_order are filled in
+ * @return: length of the operator; 0 if p is not one; -1 if the
+ * 	    # of copies is out of range */
+static int parse_shards(const char *p, PS_INFO *ps)
+{
+    const char *end;
+    long n;
+
+    if (*p != 'N' || !isdigit((unsigned char) p[1]))
+	return 0;
+    n = strtol(p + 1, (char **) &end, 10);
+    if (*end == 'o')
+	end++;
+    if (CLASS(*end) != C_BLANK && CLASS(*end) != C_END)
+	return 0;
+    if (n < 1 || n > SHARD_MAX)
+	return -1;
+
+    ps->shards = n;
+    ps->shard_order = (end[-1] == 'o');
+    return end - p;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    Command Line Parsing Interface		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Recognize a redirection operator: '<', '>', '>>' or one of
+ * them prefixed with a single digit file descriptor; '&>' and '&>>'
+ * (stdout and stderr); or a duplication, '[N]>&M' or '[N]<&M' with
+ * M a single digit, which takes no file.
+ * @p: the first character of the operator
+ * @redir: fd, flags and dup are filled in; path is left alone
+ * 	   unless the operator is a duplication
+ * @return: length of the operator; 0 if p is not one */
+int parse_redir(const char *p, REDIR *redir)
+{
+    const char *end = p;
+
+    redir->dup = -1;
+    if (*end == '&' && end[1] == '>')
+	redir->fd = REDIR_OUT_ERR, end++;
+    else if (*end >= '0' && *end <= '9')
+	redir->fd = *end++ - '0';
+    else
+	redir->fd = (*end == '<') ? STDIN_FILENO : STDOUT_FILENO;
+
+    if ((*end == '<' || *end == '>') && end[1] == '&' && redir->fd != REDIR_OUT_ERR
+	    && end[2] >= '0' && end[2] <= '9') {
+	redir->flags = 0;
+	redir->dup = end[2] - '0';
+	redir->path = (char *) NULL;
+	end += 2;
+    } else if (*end == '<' && redir->fd != REDIR_OUT_ERR)
+	redir->flags = O_RDONLY;
+    else if (*end == '>' && end[1] == '>')
+	redir->flags = O_WRONLY | O_CREAT | O_APPEND, end++;
+    else if (*end == '>')
+	redir->flags = O_WRONLY | O_CREAT | O_TRUNC;
+    else
+	return 0;
+    return ++end - p;
+}
+
+/* Parse a size: digits, optionally followed by 'k', 'm' or 'g'
+ * (either case) for KiB, MiB or GiB, as in 'pipesize 1M'.
+ * @s: the first character of the size
+ * @end: if not NULL, set to the character after the size
+ * @return: the size in bytes; -1 if s is not a size or it is
+ * 	    too large */
+long parse_size(const char *s, const char **end)
+{
+    long n = 0;
+    int shift = 0;
+
+    if (!isdigit((unsigned char) *s))
+	return -1;
+    for (; isdigit((unsigned char) *s); s++)
+	if ((n = n * 10 + *s - '0') > INT_MAX)
+	    return -1;
+    switch (*s) {
+	case 'k': case 'K': shift = 10; s++; break;
+	case 'm': case 'M': shift = 20; s++; break;
+	case 'g': case 'G': shift = 30; s++; break;
+    }
+    if (end)
+	*end = s;
+    return (n > (INT_MAX >> shift)) ? -1 : n << shift;
+}
+
+/* Parse a command line into a pipeline of processes. Operators
+ * need not be separated from words by blanks: 'a|b>out' is fine.
+ * @line: the command line string
+ * @return: the pipeline, valid until arena_reset(); it has no
+ * 	    process if the line is empty; NULL on syntax error */
+PIPELINE *parse_line(const char *line)
+{
+    const char *p = line;
+    char c, tok[8], *str;
+    int n;
+    size_t max;
+    PIPELINE *pl = (PIPELINE *) alloc_tree(strlen(line), &max);
+    PS_INFO *ps;
+    REDIR *redir, *pending = (REDIR *) NULL;
+    char **argv;
+
+    /* layout: PIPELINE | PS_INFO[max] | REDIR[max] | argv[2*max] | words */
+    pl->ps = ps = (PS_INFO *) (pl + 1);
+    redir = (REDIR *) (pl->ps + max);
+    argv = (char **) (redir + max);
+    str = (char *) (argv + 2 * max);
+
+    pl->n_ps = 0;
+    pl->background = 0;
+    ps->argc = ps->n_redirs = 0;
+    ps->argv = argv;
+    ps->redirs = redir;
+    ps->pipe_size = 0;
+    ps->shards = ps->shard_order = 0;
+
+    while (1) {
+	while (CLASS(*p) == C_BLANK)
+	    p++;
+
+	c = *p;
+	if (c == '\0' || c == '#')	/* end of line or comment */
+	    break;
+
+	if (c == '|') {
+	    if (pending || (!ps->argc && !ps->n_redirs))
+		return syntax_error("|");
+	    if (*++p == '[' && isdigit((unsigned char) p[1])) {	/* '|[1M]' */
+		if ((ps->pipe_size = parse_size(p + 1, &p)) <= 0 || *p++ != ']')
+		    return syntax_error("|[");
+	    }
+	    *argv++ = (char *) NULL;
+	    ps++;
+	    ps->argc = ps->n_redirs = 0;
+	    ps->argv = argv;
+	    ps->redirs = redir;
+	    ps->pipe_size = 0;
+	    ps->shards = ps->shard_order = 0;
+	    if ((n = parse_shards(p, ps)) == -1)
+		return syntax_error("|N");
+	    p += n;
+	    continue;
+	}
+
+	if (c == '&' && p[1] != '>') {	/* run in background; ends the line */
+	    if (pending || (!ps->argc && !ps->n_redirs))
+		return syntax_error("&");
+	    for (p++; CLASS(*p) == C_BLANK; p++)
+		;
+	    if (*p && *p != '#')
+		return syntax_error("&");
+	    pl->background = 1;
+	    break;
+	}
+
+	if ((n = parse_redir(p, redir))) {
+	    if (pending) {
+		snprintf(tok, sizeof(tok), "%.*s", n, p);
+		return syntax_error(tok);
+	    }
+	    if (redir->dup == -1)	/* a file is to follow */
+		pending = redir;
+	    redir++;
+	    ps->n_redirs++;
+	    p += n;
+	    continue;
+	}
+
+	/* a word: either an argument or a redirection target */
+	if (pending) {
+	    pending->path = str;
+	    pending = (REDIR *) NULL;
+	} else {
+	    *argv++ = str;
+	    ps->argc++;
+	}
+	if (!(p = scan_word(p, &str))) {
+	    fprintf(stderr, "-hsh: unexpected EOF while looking for matching quote\n");
+	    return (PIPELINE *) NULL;
+	}
+    }
+
+    if (pending)
+	return syntax_error("newline");
+    if (!ps->argc && !ps->n_redirs)
+	return (ps == pl->ps) ? pl : syntax_error("|");
+
+    *argv = (char *) NULL;
+    pl->n_ps = ps - pl->ps + 1;
+    return pl;
+}
@@ -1,126 +1,62 @@
 /**
  * This file is the pipe interface for Hank Shell.
+ *
+ * Pipes get the capacity set with 'pipesize', or the one given in
+ * the pipeline ('a |[1M] b'), with F_SETPIPE_SZ. With 'pipesize
+ * auto' the pipes of a foreground pipeline start at the kernel's
+ * default and while hsh waits for the pipeline it looks at them
+ * every PIPE_TICK_MS: a pipe found full, whose writer is blocked,
+ * is doubled, up to /proc/sys/fs/pipe-max-size.
  * @author: Henry Huang
  * @date: 09/22/2010
  */
 
 #include "hsh.h"
 
-extern PS_INFO *arr_ps_infos;
-extern void piped_single_threaded_cmd(int *pnargs, char **args);
+extern int last_status;
 
 //===================================================================//
 // 	     	 						     //
-// 	     	    	Pipeline Helper Functions		     //
+// 	     	 	Global Data Structures			     //
 // 	     	 						     //
 //===================================================================//
 
-/* Check for command line syntax errors.
- * @nargs: # of arguments
- * @args: command line argument buffer
- * @return: 0 if no exceptions found otherwise non-zero */
-int pipe_exception_hdlr(int nargs, char **args)
-{
-    int i, exception = 0;
-
-    /* check for exceptions */
-    exception = (!strcmp("|", args[0]))? 1 : 0;
-    exception = (!exception && !strcmp("|", args[nargs-1]))? 2 : 0;
-    
-    for (i = 0; !exception && i<(nargs-1); i++)
-	if ((!strcmp(args[i], "|") && !strcmp(args[i+1], "|"))
-	 || (!strcmp(args[i], "|") && !strcmp(args[i+1], ">"))
-	 || (!strcmp(args[i], ">") && !strcmp(args[i+1], "|"))
-	 || (!strcmp(args[i], "|") && !strcmp(args[i+1], "<"))
-	 || (!strcmp(args[i], "<") && !strcmp(args[i+1], "|"))
-	 || (!strcmp(args[i], "|") && !strcmp(args[i+1], "2>"))
-	 || (!strcmp(args[i], "2>") && !strcmp(args[i+1], "|")))
-	    exception = 3;
-
-    /* exception handling */
-    if (exception == 1)
-	fprintf(stderr, "-hsh: syntax error near unexpected token '%s'\n", args[0]);
-    else if (exception == 2)
-	fprintf(stderr, "-hsh: syntax error near unexpected token '%s'\n", args[nargs-1]);
-    else if (exception == 3)
-	fprintf(stderr, "-hsh: syntax error near unexpected token '%s'\n", args[i]);
-    else
-	exception = io_exception_hdlr(nargs, args);
-    return exception;
-}
+static long pipe_default = 0;	/* capacity of new pipes; 0: the kernel's */
+static int pipe_auto = 0;	/* grow the pipes which fill up */
+
+/* pipes being watched by pipe_adapt(): O_PATH descriptors, which
+ * are neither readers nor writers, so they don't keep a pipe open */
+static int *watched = (int *) NULL;
+static int n_watched = 0, watched_cap = 0;
 
 //===================================================================//
 // 	     	 						     //
-// 	     	    Command Line Parsing Interface		     //
+// 	     	    	   Pipe Helper Functions		     //
 // 	     	 						     //
 //===================================================================//
 
-/* Count the number of processes needed to be forked
- * @args: command line tokens including pipe symbols
- * @return: the # of processes; 1 if only one process */
-int count_processes(char **args) 
+/* Watch a pipe of the pipeline being launched for pipe_adapt().
+ * @fd: an end of the pipe */
+static void watch_pipe(int fd)
 {
-    int i, count = 1;
-
-    /* count the # of '|' symbols */
-    for (i = 0; args[i]; i++)
-	if (!strcmp(args[i], "|")) ++count;
-
-    /* return # of processes */
-    return count;
-}
-
-/* Allocate memory for processes' argument lists.
- * @num_of_ps: number of processes */
-void prepare_arg_lists(int num_of_ps)
-{
-    int i;
-
-    if (arr_ps_infos) {
-	free(arr_ps_infos);
-	arr_ps_infos = (PS_INFO *) NULL;
-    }
-
-    if (num_of_ps) {
-    	arr_ps_infos = (PS_INFO *) malloc(num_of_ps*sizeof(PS_INFO));
-    	if (!arr_ps_infos) 
-	    die_with_error("malloc");
+    char path[64];
 
-	/* initialize arr_ps_infos */
-	for (i = 0; i < num_of_ps; i++) {
-	    arr_ps_infos[i].argc = 0;
-	    arr_ps_infos[i].argv = (char **) NULL;
-	}
+    if (n_watched == watched_cap) {
+	watched_cap = watched_cap ? watched_cap * 2 : 8;
+	if (!(watched = (int *) realloc(watched, watched_cap * sizeof(int))))
+	    die_with_error("realloc");
     }
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    if (-1 != (fd = high_fd(open(path, O_PATH | O_CLOEXEC))))
+	watched[n_watched++] = fd;
 }
 
-/* Setting up PS_INFO for each process.
- * @num_of_ps: # of processes
- * @args: command line argument list */
-void set_ps_infos(int num_of_ps, char **args)
-{
-    int i , j, head;
-
-    for (i = 0, j = 0, head = 0; args[i]; i++) {
-	if (!strcmp(args[i], "|")) {
-	    arr_ps_infos[j].argc = i - head;
-	    arr_ps_infos[j].argv = &args[head];
-	    args[i] = (char *) NULL;
-	    head = i + 1;
-    	    j++;
-	}
-    }
-
-    /* the last process arg list info */
-    arr_ps_infos[j].argc = i - head;
-    arr_ps_infos[j].argv = &args[head];
-}
-
-/* Clear memory allocated for arr_ps_infos.
- * @array: array of ps_info structures */
-void clear_ps_infos(PS_INFO *array)
+/* Stop watching a pipe.
+ * @i: its index in watched[] */
+static void unwatch_pipe(int i)
 {
-    if (array) free(array);
+    close(watched[i]);
+    watched[i] = watched[--n_watched];
 }
 
 //===================================================================//
@@ -129,108 +65,150 @@ void clear_ps_infos(PS_INFO *array)
 // 	     	 						     //
 //===================================================================//
 
-/* Closing all pipes open for IPC.
- * @pipes: array of pipes 
- * @n_of_th: number of processes/threads created
- * @return: 0 if creation of pipes succeeded; 
+/* Create the pipe process idx of a pipeline writes to. Pipes are
+ * created lazily, one per pair of neighbouring processes, right 
+ * before the process writing to it is launched. Both ends are
+ * close-on-exec, so a process only inherits its own two ends.
+ * @link: pipe ends; fd_next of the previous process becomes fd_in
+ * @idx: index of the process in the pipeline
+ * @n_of_th: number of threads/processes in the pipeline
+ * @size: capacity of the pipe; 0 for the 'pipesize' default
+ * @return: 0 if creation of pipe succeeded; 
  * 	    otherwise return -1 */
-int set_pipes(int (*pipes)[2], int n_of_th)
+int set_pipes(PIPE_LINK *link, int idx, int n_of_th, long size)
 {
-    int i, rel = 0;
+    int fds[2];
 
-    /* n_of_th processes need (n_of_th - 1) pipes */
-    for (i = 0; i < n_of_th-1; ++i) {
-	if (-1 == (rel = pipe(pipes[i]))) {
-	    perror("pipe");
-	    break;
-	}
+    link->fd_in = link->fd_next;
+    link->fd_out = link->fd_next = -1;
+
+    /* the last process writes to hsh's stdout */
+    if (idx == n_of_th-1)
+	return 0;
+
+    if (-1 == pipe2(fds, O_CLOEXEC)) {
+	perror("pipe");
+	return -1;
     }
-    return rel;
+    link->fd_next = fds[0];
+    link->fd_out = fds[1];
+
+    if (!size && pipe_auto)
+	watch_pipe(fds[0]);
+    else if ((size = size ? size : pipe_default) && -1 == fcntl(fds[0], F_SETPIPE_SZ, size))
+	fprintf(stderr, "-hsh: pipe size %ld: %s\n", size, strerror(errno));
+    return 0;
 }
 
-/* Closing all pipes open for IPC.
- * @pipes: array of pipes 
- * @n_of_th: number of threads/processes in the pipeline */
-void close_pipes(int (*pipes)[2], int n_of_th)
+/* Close pipe ends hsh no longer needs once process idx has been
+ * launched; only the read end for the next process is kept.
+ * @link: pipe ends of the process */
+void close_pipes(PIPE_LINK *link)
 {
-    int i;
-    for (i = 0; i < n_of_th-1; ++i) {
-	close(pipes[i][0]);	/* close read end of ith pipe */
-	close(pipes[i][1]); 	/* close write end of ith pipe */
-    }
+    if (link->fd_in != -1)
+	close(link->fd_in);	/* close read end of previous pipe */
+    if (link->fd_out != -1)
+	close(link->fd_out); 	/* close write end of this pipe */
+    link->fd_in = link->fd_out = -1;
 }
 
-/* Wait for the first child process in the processes chain.
- * @pid: process id of the first child process
- * @return: the return value of waitpid() function */
-int wait_first_child(pid_t pid)
+/* Export exit status of every process of the last pipeline as
+ * environment variable 'PIPESTATUS', e.g. "0 1 0".
+ * @status: array of exit status
+ * @n_of_th: number of threads/processes in the pipeline */
+void set_pipe_status(int *status, int n_of_th)
 {
-    int rel;
-    if (-1 == (rel = waitpid(pid, NULL, 0)))
-    	perror("waitpid");
-    return rel;
+    int i, len = 0;
+    char *buf = (char *) arena_alloc(4 * n_of_th + 1);	/* 3 digits each */
+
+    for (i = 0; i < n_of_th; i++)
+	len += sprintf(buf + len, "%s%d", i ? " " : "", status[i]);
+    setenv("PIPESTATUS", buf, 1);
 }
 
-/* Connect pipe read end to stdin.
- * @pipes: array of pipe file descriptors
- * @idx: the pipe index we are dup-ing
- * @n_of_th: number of threads/processes in the pipeline
- * @return: the return value of dup2 system call */
-int dup_pipe_read(int (*pipes)[2], int idx, int n_of_th)
+/* Connect pipe ends to stdin and stdout of a forked process and
+ * close the originals (including the next process' read end).
+ * @link: pipe ends of the process
+ * @return: -1 if dup2 system call failed, otherwise 0 */
+int dup_pipe_read_write(PIPE_LINK *link)
 {
-    int rel; 
-    if (-1 == (rel = dup2(pipes[idx][0], STDIN_FILENO)))
-    	perror("dup2");
-    close_pipes(pipes, n_of_th);
-    return rel;
+    int rel = 0; 
+    if ((link->fd_in != -1 && -1 == (rel = dup2(link->fd_in, STDIN_FILENO))) ||
+	(link->fd_out != -1 && -1 == (rel = dup2(link->fd_out, STDOUT_FILENO))))
+    	perror("dup2 read write");
+    close_pipes(link);
+    if (link->fd_next != -1)
+	close(link->fd_next);
+    return (rel == -1) ? -1 : 0;
 }
 
-/* Connect pipe write end to stdout.
- * @pipes: array of pipe file descriptors 
- * @idx: the pipe index we are dup-ing
- * @n_of_th: number of threads/processes in the pipeline
- * @return: the return value of dup2 system call */
-int dup_pipe_write(int (*pipes)[2], int idx, int n_of_th)
+/* Grow the watched pipes which are full: their writers are blocked
+ * on them. A pipe is no longer watched once it is as large as it
+ * can be, or once its reader is gone. Called by hsh as it waits for
+ * a foreground pipeline.
+ *
+ * An O_PATH descriptor takes neither ioctl() nor F_GETPIPE_SZ, so
+ * the pipe is opened for a moment through it, as a writer: an extra
+ * reader would keep the pipe from breaking (EPIPE) if the process
+ * reading it exited, while a writer merely delays an end of file by
+ * as long as it is held. Opening a pipe without readers for writing
+ * fails (ENXIO), which tells the reader is gone.
+ * @return: # of pipes still watched */
+int pipe_adapt(void)
 {
-    int rel; 
-    if (-1 == (rel = dup2(pipes[idx][1], STDOUT_FILENO)))
-    	perror("dup2");
-    close_pipes(pipes, n_of_th);
-    return rel;
+    char path[64];
+    int i, fd, queued, size;
+
+    for (i = 0; i < n_watched; i++) {
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", watched[i]);
+	if (-1 == (fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC))) {
+	    unwatch_pipe(i--);
+	    continue;
+	}
+	size = fcntl(fd, F_GETPIPE_SZ);
+	if (!ioctl(fd, FIONREAD, &queued) && size > 0 && queued >= size
+		&& -1 == fcntl(fd, F_SETPIPE_SZ, 2 * size))
+	    unwatch_pipe(i--);	/* at the limit */
+	close(fd);
+    }
+    return n_watched;
 }
 
-/* Connect pipe write end to stdout and pipe read end to stdin.
- * @pipes: array of pipe file descriptors
- * @idx: the process index
- * @n_of_th: number of threads/processes in the pipeline
- * @return: the return value of dup2 system call */
-int dup_pipe_read_write(int (*pipes)[2], int idx, int n_of_th)
+/* Stop watching the pipes of the last pipeline. */
+void pipe_unwatch(void)
 {
-    int rel; 
-    if (-1 == (rel = dup2(pipes[n_of_th-1-idx][0], STDIN_FILENO)) ||
-	-1 == (rel = dup2(pipes[n_of_th-2-idx][1], STDOUT_FILENO)))
-    	perror("dup2 read write");
-    close_pipes(pipes, n_of_th);
-    return rel;
+    while (n_watched)
+	unwatch_pipe(n_watched - 1);
 }
 
-/* Setup pipes for a single process run the process in the pipeline.
- * @n_of_th: number of threads in the line
- * @i: index of loop; index of threads in arr_ps_infos */
-void run_piped_process(int n_of_th, int i, int (*pipes)[], pid_t pid)  
+/* pipesize builtin function: show or set the capacity of new pipes
+ * @nargs: # of arguments in command line
+ * @args: 'pipesize' alone shows the setting; 'pipesize SIZE' sets
+ * 	  it (e.g. 1M; 0 for the kernel's default) and 'pipesize auto'
+ * 	  lets full pipes grow
+ * @return: 0 if no errors otherwise 1 */
+int builtin_pipesize(int nargs, char **args)
 {
-    if (i == n_of_th) {	/* parent of all processes */
-	close_pipes(pipes, n_of_th);
-    	usleep(50000);
-	wait_first_child(pid); 
-    } else if (i == n_of_th - 1) {   /* first child in the chain */
-	if (-1 == dup_pipe_read(pipes, 0, n_of_th)) _exit(EXIT_FAILURE);
-    	piped_single_threaded_cmd(&arr_ps_infos[i].argc, arr_ps_infos[i].argv);
-    } else if (i == 0) {    /* last child in the chain gets here */
-	if (-1 == dup_pipe_write(pipes, n_of_th-2, n_of_th)) _exit(EXIT_FAILURE);
-    	piped_single_threaded_cmd(&arr_ps_infos[i].argc, arr_ps_infos[i].argv);
-    } else {    /* processes in the middle of the chain get here */
-	if (-1 == dup_pipe_read_write(pipes, i, n_of_th)) _exit(EXIT_FAILURE);
-    	piped_single_threaded_cmd(&arr_ps_infos[i].argc, arr_ps_infos[i].argv);
-    }	
+    long size;
+    const char *end;
+
+    if (nargs == 1) {
+	if (pipe_auto)
+	    printf("auto\n");
+	else
+	    printf("%ld\n", pipe_default);
+	return 0;
+    }
+    if (nargs == 2 && !strcmp(args[1], "auto")) {
+	pipe_auto = 1;
+	pipe_default = 0;
+	return 0;
+    }
+    if (nargs != 2 || (size = parse_size(args[1], &end)) < 0 || *end) {
+	fprintf(stderr, "-hsh: pipesize: usage: pipesize [SIZE|auto]\n");
+	return 1;
+    }
+    pipe_auto = 0;
+    pipe_default = size;
+    return 0;
 }
@@ -0,0 +1,249 @@
+/**
+ * This file is the prompt engine of Hank Shell. The prompt format,
+ * PS1, is compiled once into a list of segments: literal text and
+ * escapes such as \u (user) or \w (working directory). The value of
+ * every escape and the rendered prompt are cached, and invalidated
+ * only by the events which change them: a change of directory for
+ * \w and \W, a variable assignment for \u and PS1 itself, a new exit
+ * status for \?. An idle Enter thus redraws the prompt without any
+ * system call.
+ *
+ * Escapes: \u user, \h hostname up to the first '.', \H hostname,
+ * 	    \w working directory with $HOME as '~', \W its last part,
+ * 	    \$ '#' for root otherwise '$', \? exit status of the last
+ * 	    command, \n newline, \\ backslash.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern char cwd[];
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* the prompt when PS1 is not set */
+#define PS1_DEFAULT "\\u@\\H:\\w# "
+
+/* kinds of segments */
+#define SEG_TEXT	0	/* literal text */
+#define SEG_USER	1	/* \u */
+#define SEG_HOST	2	/* \h */
+#define SEG_HOST_FULL	3	/* \H */
+#define SEG_CWD		4	/* \w */
+#define SEG_CWD_BASE	5	/* \W */
+#define SEG_ROOT	6	/* \$ */
+#define SEG_STATUS	7	/* \? */
+#define N_SEG_KINDS	8
+
+/* A segment of the compiled prompt */
+typedef struct {
+    int kind;
+    const char *text;	/* SEG_TEXT only: the text, in ps1 */
+    size_t len;
+} SEGMENT;
+
+static char *ps1 = (char *) NULL;	/* copy of the format compiled */
+static SEGMENT *segs = (SEGMENT *) NULL;
+static int n_segs = 0;
+static int uses_status = 0;		/* the format has \? */
+
+/* cached value of each kind of escape; NULL if not known */
+static char *values[N_SEG_KINDS];
+
+/* the rendered prompt; valid unless dirty */
+static char *prompt = (char *) NULL;
+static size_t prompt_cap = 0;
+static int dirty = 1;
+static int shown_status = -1;		/* status \? was rendered with */
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Prompt Helper Functions			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Compile a prompt format into segments.
+ * @fmt: the format */
+static void compile(const char *fmt)
+{
+    static const char escapes[] = "uhHwW$?";
+    const char *p, *esc;
+    SEGMENT *seg;
+
+    free(ps1);
+    free(segs);
+    ps1 = dupstr((char *) fmt);
+    if (!(segs = (SEGMENT *) malloc((strlen(fmt) + 1) * sizeof(SEGMENT))))
+	die_with_error("malloc");
+    n_segs = uses_status = 0;
+
+    for (p = ps1; *p; ) {
+	seg = &segs[n_segs++];
+	if (*p == '\\' && p[1] && (esc = strchr(escapes, p[1]))) {
+	    seg->kind = SEG_USER + (esc - escapes);
+	    uses_status |= (seg->kind == SEG_STATUS);
+	    p += 2;
+	} else if (*p == '\\' && (p[1] == 'n' || p[1] == '\\')) {
+	    seg->kind = SEG_TEXT;
+	    seg->text = (p[1] == 'n') ? "\n" : "\\";
+	    seg->len = 1;
+	    p += 2;
+	} else {			/* text up to the next escape */
+	    seg->kind = SEG_TEXT;
+	    seg->text = p;
+	    for (p++; *p && *p != '\\'; p++)
+		;
+	    seg->len = p - seg->text;
+	}
+    }
+}
+
+/* Compute the value of an escape.
+ * @kind: kind of the segment
+ * @return: the value; a new string */
+static char *compute(int kind)
+{
+    char buf[PATH_SIZE], *s, *home;
+    size_t n;
+    uint64_t t;
+
+    switch (kind) {
+	case SEG_USER:
+	    if (!(s = getenv("USERNAME")) && !(s = getenv("USER")))
+		s = "";
+	    return dupstr(s);
+	case SEG_HOST:
+	case SEG_HOST_FULL:
+	    if (gethostname(buf, sizeof(buf)))
+		buf[0] = '\0';
+	    buf[sizeof(buf)-1] = '\0';
+	    if (kind == SEG_HOST && (s = strchr(buf, '.')))
+		*s = '\0';
+	    return dupstr(buf);
+	case SEG_CWD:		/* traced as prompt_cwd */
+	    t = trace_begin();
+	    home = getenv("HOME");
+	    n = home ? strlen(home) : 0;
+	    if (n > 1 && !strncmp(cwd, home, n) && (!cwd[n] || cwd[n] == '/'))
+		snprintf(buf, sizeof(buf), "~%s", cwd + n);
+	    else
+		snprintf(buf, sizeof(buf), "%s", cwd);
+	    trace_end(TRACE_PROMPT_CWD, t);
+	    return dupstr(buf);
+	case SEG_CWD_BASE:
+	    s = strrchr(cwd, '/');
+	    return dupstr((s && s[1]) ? s + 1 : cwd);
+	case SEG_ROOT:
+	    return dupstr(geteuid() ? "$" : "#");
+	case SEG_STATUS:
+	    snprintf(buf, sizeof(buf), "%d", last_status);
+	    return dupstr(buf);
+    }
+    return dupstr("");
+}
+
+/* Forget the cached value of an escape. */
+static void forget(int kind)
+{
+    free(values[kind]);
+    values[kind] = (char *) NULL;
+}
+
+/* Render the prompt from its segments and cached values. */
+static void render(void)
+{
+    int i;
+    size_t len = 0, n;
+    const char *s;
+
+    for (i = 0; i < n_segs; i++) {
+	if (segs[i].kind == SEG_TEXT) {
+	    s = segs[i].text;
+	    n = segs[i].len;
+	} else {
+	    if (!values[segs[i].kind])
+		values[segs[i].kind] = compute(segs[i].kind);
+	    s = values[segs[i].kind];
+	    n = strlen(s);
+	}
+	if (len + n + 1 > prompt_cap) {
+	    prompt_cap = (len + n + 1) * 2;
+	    if (!(prompt = (char *) realloc(prompt, prompt_cap)))
+		die_with_error("realloc");
+	}
+	memcpy(prompt + len, s, n);
+	len += n;
+    }
+    if (!prompt && !(prompt = (char *) calloc(prompt_cap = 1, 1)))
+	die_with_error("calloc");
+    prompt[len] = '\0';
+    dirty = 0;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    Prompt Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Tell the prompt engine something it shows may have changed.
+ * @what: PROMPT_CWD after a change of directory, PROMPT_VARS
+ * 	  after a change of environment variables */
+void prompt_invalidate(int what)
+{
+    const char *fmt;
+
+    if (what & PROMPT_CWD) {
+	forget(SEG_CWD);
+	forget(SEG_CWD_BASE);
+    }
+    if (what & PROMPT_VARS) {
+	forget(SEG_USER);
+	forget(SEG_CWD);	/* $HOME */
+	if (!(fmt = getenv("PS1")))
+	    fmt = PS1_DEFAULT;
+	if (!ps1 || strcmp(fmt, ps1))
+	    compile(fmt);
+    }
+    dirty = 1;
+}
+
+/* Get the prompt, rendering it only if something it shows changed.
+ * @return: the prompt; valid until the next call */
+const char *prompt_get(void)
+{
+    if (!ps1)
+	prompt_invalidate(PROMPT_VARS);
+
+    if (uses_status && shown_status != last_status) {
+	forget(SEG_STATUS);
+	shown_status = last_status;
+	dirty = 1;
+    }
+    if (dirty)
+	render();
+    return prompt;
+}
+
+/* Release memory of the prompt engine. */
+void prompt_clean(void)
+{
+    int i;
+
+    for (i = 0; i < N_SEG_KINDS; i++)
+	forget(i);
+    free(ps1);
+    free(segs);
+    free(prompt);
+    ps1 = prompt = (char *) NULL;
+    segs = (SEGMENT *) NULL;
+    n_segs = 0;
+    prompt_cap = 0;
+    dirty = 1;
+}
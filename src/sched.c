@@ -0,0 +1,201 @@
+/**
+ * This file implements the 'sched' prefix of Hank Shell: a command
+ * line starting with 'sched [--cpus LIST] [--nice N] [--batch|--idle]
+ * [--spread]' runs each process of its pipeline with the given CPU
+ * affinity, niceness and scheduling policy, or, with '--spread', on
+ * one CPU of the list each, assigned round-robin by stage. Spawn
+ * attributes can express none of this but the policy, so every
+ * process of such a line is forked and sets itself up before exec.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* whether the line being run has a 'sched' prefix */
+static int sched_on = 0;
+
+/* CPUs the processes run on, in ascending order; affinity is left
+ * alone if there are none */
+static cpu_set_t sched_cpus;
+static int sched_n_cpus = 0;
+static int sched_spread = 0;
+
+/* niceness increment, and policy or -1 to keep SCHED_OTHER */
+static int sched_nice = 0;
+static int sched_policy = -1;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Scheduling Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Parse a CPU list such as '0-3,8,10-11' into a set.
+ * @s: the list
+ * @set: the set to be filled
+ * @return: # of CPUs in the set; -1 if the list is malformed */
+static int parse_cpus(const char *s, cpu_set_t *set)
+{
+    char *end;
+    long lo, hi;
+
+    CPU_ZERO(set);
+    do {
+	if (!isdigit((unsigned char) *s))
+	    return -1;
+	lo = hi = strtol(s, &end, 10);
+	if (*end == '-') {
+	    if (!isdigit((unsigned char) end[1]))
+		return -1;
+	    hi = strtol(end + 1, &end, 10);
+	}
+	if (lo > hi || hi >= CPU_SETSIZE)
+	    return -1;
+	for (; lo <= hi; lo++)
+	    CPU_SET(lo, set);
+	s = end + 1;
+    } while (*end == ',');
+
+    return *end ? -1 : CPU_COUNT(set);
+}
+
+/* Parse the options of the prefix.
+ * @args: the words after 'sched'
+ * @n: # of words
+ * @return: # of words taken by options; -1 on error */
+static int sched_options(char **args, int n)
+{
+    int k, cpu;
+    char *end;
+    cpu_set_t allowed;
+
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (k = 0; k < n && !strncmp(args[k], "--", 2); k++) {
+	if (!strcmp(args[k], "--")) {
+	    k++;
+	    break;
+	} else if (!strcmp(args[k], "--batch")) {
+	    sched_policy = SCHED_BATCH;
+	} else if (!strcmp(args[k], "--idle")) {
+	    sched_policy = SCHED_IDLE;
+	} else if (!strcmp(args[k], "--spread")) {
+	    sched_spread = 1;
+	} else if (!strcmp(args[k], "--cpus") || !strcmp(args[k], "--nice")) {
+	    if (k + 1 == n) {
+		fprintf(stderr, "-hsh: sched: %s: option requires an argument\n", args[k]);
+		return -1;
+	    }
+	    if (args[k++][2] == 'c') {
+		if (-1 == (sched_n_cpus = parse_cpus(args[k], &sched_cpus))) {
+		    fprintf(stderr, "-hsh: sched: %s: invalid CPU list\n", args[k]);
+		    return -1;
+		}
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		    if (CPU_ISSET(cpu, &sched_cpus) && !CPU_ISSET(cpu, &allowed)) {
+			fprintf(stderr, "-hsh: sched: %d: CPU not available\n", cpu);
+			return -1;
+		    }
+		}
+	    } else {
+		sched_nice = strtol(args[k], &end, 10);
+		if (!*args[k] || *end) {
+		    fprintf(stderr, "-hsh: sched: %s: invalid niceness\n", args[k]);
+		    return -1;
+		}
+	    }
+	} else {
+	    fprintf(stderr, "-hsh: sched: %s: invalid option\n", args[k]);
+	    fprintf(stderr, "sched: usage: sched [--cpus LIST] [--nice N] "
+		    "[--batch|--idle] [--spread] pipeline\n");
+	    return -1;
+	}
+    }
+
+    /* spreading without a list goes over the CPUs hsh may use */
+    if (sched_spread && !sched_n_cpus) {
+	sched_cpus = allowed;
+	sched_n_cpus = CPU_COUNT(&allowed);
+    }
+    return k;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Scheduling Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Strip a 'sched' prefix off a parsed line and remember its
+ * settings for the processes of the line.
+ * @pl: the parsed line
+ * @return: 0 on success; -1 on error */
+int sched_prefix(PIPELINE *pl)
+{
+    PS_INFO *ps = pl->ps;
+    int k;
+
+    sched_on = 0;
+    if (!pl->n_ps || !ps->argc || strcmp(ps->argv[0], "sched"))
+	return 0;
+
+    sched_n_cpus = sched_spread = sched_nice = 0;
+    sched_policy = -1;
+    if (-1 == (k = sched_options(ps->argv + 1, ps->argc - 1)))
+	return -1;
+    ps->argv += k + 1;
+    ps->argc -= k + 1;
+    if (!ps->argc) {
+	fprintf(stderr, pl->n_ps > 1 ? "-hsh: syntax error near unexpected token '|'\n" :
+		"-hsh: sched: a command is required\n");
+	return -1;
+    }
+
+    sched_on = 1;
+    return 0;
+}
+
+/* Whether the processes of the line being run are to be forked
+ * and set up by sched_apply(). */
+int sched_active(void)
+{
+    return sched_on;
+}
+
+/* Set the affinity, policy and niceness of the calling process, a
+ * child about to run its stage of the line. Failures are reported
+ * and the command runs anyway, as with nice(1).
+ * @stage: index of the process in its pipeline */
+void sched_apply(int stage)
+{
+    int cpu, k;
+    cpu_set_t one;
+    struct sched_param param = { 0 };
+
+    if (!sched_on)
+	return;
+
+    if (sched_spread) {
+	k = stage % sched_n_cpus;
+	for (cpu = 0; !CPU_ISSET(cpu, &sched_cpus) || k--; cpu++)
+	    ;
+	CPU_ZERO(&one);
+	CPU_SET(cpu, &one);
+    }
+    if (sched_n_cpus && -1 == sched_setaffinity(0, sizeof(cpu_set_t),
+		sched_spread ? &one : &sched_cpus))
+	fprintf(stderr, "-hsh: sched: cannot set CPU affinity: %s\n", strerror(errno));
+
+    if (sched_policy != -1 && -1 == sched_setscheduler(0, sched_policy, &param))
+	fprintf(stderr, "-hsh: sched: cannot set policy: %s\n", strerror(errno));
+
+    errno = 0;
+    if (sched_nice && -1 == nice(sched_nice) && errno)
+	fprintf(stderr, "-hsh: sched: cannot set niceness: %s\n", strerror(errno));
+}
@@ -0,0 +1,436 @@
+/**
+ * This file implements sharded pipeline stages for Hank Shell: in
+ * 'a |N8 b | c' hsh runs 8 copies of b, splits the output of a on
+ * line boundaries across them and merges their outputs into the
+ * pipe to c. The stage is a forked hsh in the job, the shard
+ * process, which launches the copies and moves all the data
+ * between its pipe ends and theirs with poll(2).
+ *
+ * With '|N8' the copies run for the whole input; complete lines go
+ * to whichever copy is ready for more, and the outputs are merged a
+ * line at a time, in no particular order. With '|N8o' the input is
+ * cut into blocks of about SHARD_BLOCK bytes numbered in sequence,
+ * each run by a fresh copy, at most 8 at a time; the copy of the
+ * oldest block unwritten streams its output and the others are kept
+ * until their turn, so the output is in the order of the input.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define SHARD_CHUNK	(64 << 10)	/* bytes read at a time */
+#define SHARD_BLOCK	(1 << 20)	/* input of a copy with '|No' */
+
+/* a byte buffer; data[off, len) is yet to be written */
+typedef struct {
+    char *data;
+    size_t off, len, cap;
+} SHARD_BUF;
+
+/* a copy of the stage */
+typedef struct {
+    pid_t pid;		/* process id; -1 once reaped */
+    int in;		/* write end of its stdin; -1 once closed */
+    int out;		/* read end of its stdout; -1 once closed */
+    long seq;		/* # of the block it runs with '|No' */
+    SHARD_BUF input;	/* lines handed to it */
+    SHARD_BUF output;	/* its output not merged yet */
+} SHARD;
+
+static PS_INFO *stage_ps;	/* the stage being run */
+static JOB *stage_job;
+static int stage_idx;
+
+static SHARD *shards;
+static int n_shards, ordered;
+static SHARD_BUF pending;	/* input not handed to a copy yet */
+static int input_done = 0;
+static long next_seq = 0;	/* block to be handed out next */
+static long head_seq = 0;	/* oldest block whose output is unwritten */
+static int shard_status = 0;	/* status of the first copy failing */
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	  Shard Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Make room for n more bytes at the end of a buffer. */
+static void buf_reserve(SHARD_BUF *b, size_t n)
+{
+    if (b->off == b->len)
+	b->off = b->len = 0;
+    if (b->cap - b->len >= n)
+	return;
+    if (b->off) {
+	memmove(b->data, b->data + b->off, b->len - b->off);
+	b->len -= b->off;
+	b->off = 0;
+    }
+    while (b->cap - b->len < n)
+	b->cap = b->cap ? b->cap * 2 : SHARD_CHUNK;
+    if (!(b->data = (char *) realloc(b->data, b->cap)))
+	die_with_error("realloc");
+}
+
+/* Write n bytes of a buffer to the stdout of the stage. A reader
+ * gone is the end of the shard process, by the SIGPIPE it blocks. */
+static void buf_flush(SHARD_BUF *b, size_t n)
+{
+    ssize_t rel;
+    sigset_t set;
+
+    while (n) {
+	if (-1 == (rel = write(STDOUT_FILENO, b->data + b->off, n))) {
+	    if (errno == EINTR)
+		continue;
+	    sigemptyset(&set);
+	    sigaddset(&set, SIGPIPE);
+	    sigprocmask(SIG_UNBLOCK, &set, NULL);
+	    perror("write");
+	    _exit(EXIT_FAILURE);
+	}
+	b->off += rel;
+	n -= rel;
+    }
+}
+
+/* # of bytes of the pending input which may be handed to a copy:
+ * its complete lines, or all of it at the end of the input.
+ * @min: fewer bytes are not handed out before the end of input
+ * @return: # of bytes; 0 if none */
+static size_t shard_ready(size_t min)
+{
+    char *nl;
+
+    if (pending.len == pending.off)
+	return 0;
+    if (input_done)
+	return pending.len - pending.off;
+    if (pending.len - pending.off < min ||
+	    !(nl = memrchr(pending.data + pending.off, '\n', pending.len - pending.off)))
+	return 0;
+    return nl + 1 - (pending.data + pending.off);
+}
+
+/* Hand n bytes of the pending input to a copy, whose input buffer
+ * is empty; the buffers are swapped, so only the rest is copied. */
+static void shard_hand(SHARD *s, size_t n)
+{
+    SHARD_BUF b = s->input;
+    size_t end = pending.off + n, rest = pending.len - end;
+
+    s->input = pending;
+    s->input.len = end;
+    pending = b;
+    pending.off = pending.len = 0;
+    buf_reserve(&pending, rest);
+    memcpy(pending.data, s->input.data + end, rest);
+    pending.len = rest;
+}
+
+/* Launch a copy of the stage, connected to two new pipes. The
+ * copy gets its own copy of the redirections of the stage, as they
+ * are expanded in place: every copy expands them as written.
+ * @s: the copy
+ * @k: its slot, which sets its stage for 'sched --spread'
+ * @return: 0 on success; -1 on error */
+static int shard_launch(SHARD *s, int k)
+{
+    int in[2], out[2];
+    PIPE_LINK link;
+    PS_INFO ps = *stage_ps;
+
+    if (-1 == pipe2(in, O_CLOEXEC)) {
+	perror("pipe");
+	return -1;
+    }
+    if (-1 == pipe2(out, O_CLOEXEC)) {
+	perror("pipe");
+	close(in[0]);
+	close(in[1]);
+	return -1;
+    }
+
+    /* a builtin copy is forked rather than spawned; fd_next is what
+     * it closes for its stdin to end with the input */
+    link.fd_in = in[0];
+    link.fd_out = out[1];
+    link.fd_next = in[1];
+    ps.redirs = (REDIR *) arena_alloc((ps.n_redirs + 1) * sizeof(REDIR));
+    memcpy(ps.redirs, stage_ps->redirs, ps.n_redirs * sizeof(REDIR));
+    s->pid = piped_single_threaded_cmd(&ps, &link, stage_job, stage_idx + k);
+    close_pipes(&link);
+    if (-1 == s->pid) {
+	close(in[1]);
+	close(out[0]);
+	return -1;
+    }
+
+    /* hsh must never block on a single copy */
+    s->in = in[1];
+    s->out = out[0];
+    fcntl(s->in, F_SETFL, O_NONBLOCK);
+    fcntl(s->out, F_SETFL, O_NONBLOCK);
+    return 0;
+}
+
+/* Kill the copies launched so far, when the stage cannot run, and
+ * reap them. */
+static void shard_kill(void)
+{
+    int i;
+    SHARD *s;
+
+    for (i = 0; i < n_shards; i++) {
+	s = &shards[i];
+	if (s->in != -1)
+	    close(s->in);
+	if (s->out != -1)
+	    close(s->out);
+	s->in = s->out = -1;
+	if (s->pid > 0) {
+	    kill(s->pid, SIGTERM);
+	    while (-1 == waitpid(s->pid, NULL, 0) && errno == EINTR)
+		;
+	    s->pid = -1;
+	}
+    }
+}
+
+/* Reap a copy whose output has ended, remembering the status of
+ * the first one failing. */
+static void shard_reap(SHARD *s)
+{
+    int status;
+
+    while (-1 == waitpid(s->pid, &status, 0) && errno == EINTR)
+	;
+    status = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+    if (status && !shard_status)
+	shard_status = status;
+    s->pid = -1;
+}
+
+/* Write the output of the copies of finished blocks in order, up
+ * to the oldest block still running, whose output then streams. */
+static void shard_advance(void)
+{
+    SHARD *s;
+
+    for (; head_seq < next_seq; head_seq++) {
+	s = &shards[head_seq % n_shards];
+	buf_flush(&s->output, s->output.len - s->output.off);
+	if (s->out != -1)
+	    break;
+    }
+}
+
+/* Move the output of a copy: read what it wrote and merge it into
+ * the stdout of the stage. */
+static void shard_merge(SHARD *s)
+{
+    char *nl;
+    ssize_t n;
+    SHARD_BUF *b = &s->output;
+
+    buf_reserve(b, SHARD_CHUNK);
+    if (-1 == (n = read(s->out, b->data + b->len, b->cap - b->len)))
+	return;			/* EAGAIN or EINTR */
+    b->len += n;
+
+    if (!n) {			/* the copy is done */
+	close(s->out);
+	s->out = -1;
+	shard_reap(s);
+    }
+
+    if (ordered) {		/* only the oldest block streams */
+	if (s->seq == head_seq)
+	    shard_advance();
+    } else if (!n) {
+	buf_flush(b, b->len - b->off);
+    } else if ((nl = memrchr(b->data + b->off, '\n', b->len - b->off))) {
+	buf_flush(b, nl + 1 - (b->data + b->off));
+    }
+}
+
+/* Move input to a copy. Once the copy has it all, its stdin is
+ * closed with '|No', or with '|N' at the end of the input. */
+static void shard_feed(SHARD *s)
+{
+    ssize_t n;
+    SHARD_BUF *b = &s->input;
+
+    n = write(s->in, b->data + b->off, b->len - b->off);
+    if (-1 == n && errno == EPIPE)	/* the copy reads no more */
+	b->off = b->len;
+    else if (n > 0)
+	b->off += n;
+
+    if (b->off == b->len && (ordered || n == -1 || (input_done && !shard_ready(1)))) {
+	close(s->in);
+	s->in = -1;
+    }
+}
+
+/* Run the stage: launch its copies, then move data until the copies
+ * are done with all the input.
+ * @return: exit status of the stage */
+static int shard_run(void)
+{
+    int i, k, busy, next = 0;
+    size_t n;
+    ssize_t rel;
+    SHARD *s;
+    struct pollfd fds[2 * SHARD_MAX + 1];
+
+    if (!(shards = (SHARD *) calloc(n_shards, sizeof(SHARD))))
+	die_with_error("calloc");
+    for (i = 0; i < n_shards; i++) {
+	shards[i].pid = -1;
+	shards[i].in = shards[i].out = -1;
+    }
+
+    /* with '|N' the copies run from the start */
+    for (i = 0; !ordered && i < n_shards; i++) {
+	if (-1 == shard_launch(&shards[i], i)) {
+	    shard_kill();
+	    return last_status ? last_status : EXIT_FAILURE;
+	}
+    }
+
+    while (1) {
+	/* hand the pending input out: a block to a new copy for '|No',
+	 * lines to the next copy done with its own for '|N' */
+	busy = 1;
+	if (ordered) {
+	    while (next_seq - head_seq < n_shards && (n = shard_ready(SHARD_BLOCK))) {
+		s = &shards[next_seq % n_shards];
+		if (-1 == shard_launch(s, next_seq % n_shards)) {
+		    if (!shard_status)
+			shard_status = last_status ? last_status : EXIT_FAILURE;
+		    input_done = 1;
+		    pending.off = pending.len = 0;
+		    break;
+		}
+		s->seq = next_seq++;
+		shard_hand(s, n);
+	    }
+	    busy = (next_seq - head_seq == n_shards);
+	} else {
+	    for (i = 0; i < n_shards; i++) {
+		s = &shards[k = (next + i) % n_shards];
+		if (s->in == -1 || s->input.off != s->input.len)
+		    continue;
+		if ((n = shard_ready(1))) {
+		    shard_hand(s, n);
+		    next = k + 1;
+		} else if (input_done) {
+		    close(s->in);
+		    s->in = -1;
+		} else {
+		    busy = 0;
+		}
+	    }
+	}
+
+	/* the input is read only while a copy can take more */
+	fds[0].fd = (!input_done && !busy) ? STDIN_FILENO : -1;
+	fds[0].events = POLLIN;
+	for (i = 0, k = fds[0].fd != -1; i < n_shards; i++) {
+	    s = &shards[i];
+	    fds[2 * i + 1].fd = (s->input.off != s->input.len) ? s->in : -1;
+	    fds[2 * i + 1].events = POLLOUT;
+	    fds[2 * i + 2].fd = s->out;
+	    fds[2 * i + 2].events = POLLIN;
+	    k += (fds[2 * i + 1].fd != -1) + (s->out != -1);
+	}
+	if (!k)
+	    break;
+	if (-1 == poll(fds, 2 * n_shards + 1, -1)) {
+	    if (errno == EINTR)
+		continue;
+	    perror("poll");
+	    return EXIT_FAILURE;
+	}
+
+	if (fds[0].revents) {
+	    buf_reserve(&pending, SHARD_CHUNK);
+	    rel = read(STDIN_FILENO, pending.data + pending.len, pending.cap - pending.len);
+	    if (rel > 0)
+		pending.len += rel;
+	    else if (!rel || (errno != EINTR && errno != EAGAIN))
+		input_done = 1;
+	}
+	for (i = 0; i < n_shards; i++) {
+	    if (fds[2 * i + 1].fd != -1 && fds[2 * i + 1].revents)
+		shard_feed(&shards[i]);
+	    if (fds[2 * i + 2].fd != -1 && fds[2 * i + 2].revents)
+		shard_merge(&shards[i]);
+	}
+    }
+
+    return shard_status;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	  Sharded Stage Interface		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Launch a sharded stage of a pipeline: the shard process, which
+ * runs ps->shards copies of the stage between its pipe ends.
+ * @ps: the stage, with its argument list and redirections, which
+ * 	every copy gets
+ * @link: pipe ends of the stage
+ * @job: the job the stage belongs to
+ * @stage: index of the stage in its pipeline
+ * @return: process id of the shard process; -1 on error */
+pid_t shard_cmd(PS_INFO *ps, PIPE_LINK *link, JOB *job, int stage)
+{
+    pid_t pid;
+    sigset_t set;
+
+    if (-1 == (pid = fork())) {
+	perror("fork");
+	return -1;
+    } else if (pid) {
+	return pid;
+    }
+
+    /* child process: join the job and connect pipes; it reaps its
+     * copies itself and sees readers gone as EPIPE, while the
+     * copies get the signal mask of hsh */
+    job_child_setup(job);
+    if (-1 == dup_pipe_read_write(link))
+	_exit(EXIT_FAILURE);
+
+    /* with no process launched before it, e.g. a first stage not
+     * found, the shard process leads the group of the job, which
+     * hsh only learns once fork() returns: its copies must join
+     * that group for ^C and ^Z to reach them */
+    if (job && !job->pgid)
+	job->pgid = getpid();
+    signal(SIGCHLD, SIG_DFL);
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+
+    stage_ps = ps;
+    stage_job = job;
+    stage_idx = stage;
+    n_shards = ps->shards;
+    ordered = ps->shard_order;
+    _exit(shard_run());
+}
@@ -0,0 +1,90 @@
+/**
+ * This file is the process spawning backend for Hank Shell.
+ * External commands are started with posix_spawn(3), which glibc
+ * implements with clone(CLONE_VM|CLONE_VFORK): no page tables of
+ * hsh are copied, however large its history and readline state grow.
+ * Redirections and pipe ends are applied as spawn file actions.
+ * Builtins that must run in a child still use fork(2), as do the
+ * commands of a 'sched' line, which set themselves up before exec.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern char **environ;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Process Spawning Interface		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Spawn a process running an external command.
+ * @cmd_path: path of the command being executed
+ * @args: command line arguments
+ * @actions: file actions applied in the child before exec;
+ * 	     NULL if none
+ * @job: the job the process belongs to
+ * @return: process id of the child; -1 on error with errno set */
+pid_t spawn_cmd(char *cmd_path, char **args, posix_spawn_file_actions_t *actions,
+	JOB *job)
+{
+    int rel;
+    pid_t pid;
+    posix_spawnattr_t attr;
+
+    posix_spawnattr_init(&attr);
+    job_spawn_attr(&attr, job);
+    rel = posix_spawn(&pid, cmd_path, actions, &attr, args, environ);
+    posix_spawnattr_destroy(&attr);
+
+    if (rel) {
+	errno = rel;
+	return -1;
+    }
+    return pid;
+}
+
+/* Add file actions connecting a process to its neighbours in a
+ * pipeline; the spawning counterpart of dup_pipe_read_write().
+ * Pipe ends are close-on-exec, so they need no close action.
+ * @actions: file actions of the process
+ * @link: pipe ends of the process */
+void spawn_pipe_actions(posix_spawn_file_actions_t *actions, PIPE_LINK *link)
+{
+    if (link->fd_in != -1)	/* read from previous process */
+	posix_spawn_file_actions_adddup2(actions, link->fd_in, STDIN_FILENO);
+    if (link->fd_out != -1)	/* write to next process */
+	posix_spawn_file_actions_adddup2(actions, link->fd_out, STDOUT_FILENO);
+}
+
+/* Fork a process running an external command, for what spawn
+ * attributes cannot express: the child of a 'sched' line sets its
+ * CPU affinity, policy and niceness itself before exec.
+ * @cmd_path: path of the command being executed
+ * @args: command line arguments
+ * @link: pipe ends of the process
+ * @redirs: redirections to be done on the process
+ * @n_redirs: # of redirections
+ * @job: the job the process belongs to
+ * @stage: index of the process in its pipeline
+ * @return: process id of the child; -1 on error with errno set */
+pid_t fork_cmd(char *cmd_path, char **args, PIPE_LINK *link, REDIR *redirs,
+	int n_redirs, JOB *job, int stage)
+{
+    pid_t pid;
+
+    if ((pid = fork()))
+	return pid;
+
+    /* child process: join the job, connect pipes, redirections,
+     * then scheduling */
+    job_child_setup(job);
+    if (-1 == dup_pipe_read_write(link) || io_apply(redirs, n_redirs, 0))
+	_exit(EXIT_FAILURE);
+    sched_apply(stage);
+    execv(cmd_path, args);
+    fprintf(stderr, "-hsh: %s: %s\n", args[0], strerror(errno));
+    _exit((errno == ENOENT) ? 127 : 126);
+}
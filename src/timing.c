@@ -0,0 +1,263 @@
+/**
+ * This file implements the 'time' prefix of Hank Shell: a command
+ * line starting with 'time [-j]' reports, once its job is done, the
+ * wall clock time, user and system time, max RSS, context switches
+ * and page faults of each process of the pipeline, plus a total.
+ * Processes are reaped with wait4(), which hands back their resource
+ * usage; a builtin run inside hsh is measured with getrusage().
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+extern int last_status;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+/* report format of the line being run; 0 if it is not timed */
+static int time_format = 0;
+
+/* the timed line, without the prefix, and whether a job took
+ * over reporting it */
+static const char *time_line = (const char *) NULL;
+static int time_taken = 0;
+
+/* hsh itself when the line started, for builtins run inside hsh */
+static PROCESS time_self;
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Timing Helper Functions			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Difference of two points in time in seconds. */
+static double ts_diff(const struct timespec *end, const struct timespec *start)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* A timeval in seconds. */
+static double tv_secs(const struct timeval *tv)
+{
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+/* Add resource usage b to a; max RSS adds up too, since the
+ * processes of a pipeline run side by side. */
+static void ru_add(struct rusage *a, const struct rusage *b)
+{
+    timeradd(&a->ru_utime, &b->ru_utime, &a->ru_utime);
+    timeradd(&a->ru_stime, &b->ru_stime, &a->ru_stime);
+    a->ru_maxrss += b->ru_maxrss;
+    a->ru_nvcsw += b->ru_nvcsw;
+    a->ru_nivcsw += b->ru_nivcsw;
+    a->ru_minflt += b->ru_minflt;
+    a->ru_majflt += b->ru_majflt;
+}
+
+/* Print a line of the text report.
+ * @label: stage number or "total"
+ * @pid: process id; 0 to leave it out */
+static void print_text(const char *label, pid_t pid, int status,
+	double real, const struct rusage *ru)
+{
+    char spid[16] = "";
+
+    if (pid > 0)
+	snprintf(spid, sizeof(spid), "%d", (int) pid);
+    fprintf(stderr, "%-6s %8s %6d %9.3fs %9.3fs %9.3fs %8ldK %7ld %7ld %8ld %6ld\n",
+	    label, spid, status, real, tv_secs(&ru->ru_utime), tv_secs(&ru->ru_stime),
+	    ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw, ru->ru_minflt, ru->ru_majflt);
+}
+
+/* Print the fields of a JSON object of the report. */
+static void print_json(int status, double real, const struct rusage *ru)
+{
+    fprintf(stderr, "\"status\":%d,\"real\":%.6f,\"user\":%.6f,\"sys\":%.6f,"
+	    "\"maxrss_kb\":%ld,\"vcsw\":%ld,\"ivcsw\":%ld,\"minflt\":%ld,\"majflt\":%ld",
+	    status, real, tv_secs(&ru->ru_utime), tv_secs(&ru->ru_stime),
+	    ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw, ru->ru_minflt, ru->ru_majflt);
+}
+
+/* Print a string as a JSON string literal. */
+static void print_json_string(const char *s)
+{
+    fputc('"', stderr);
+    for (; *s; s++) {
+	if (*s == '"' || *s == '\\')
+	    fprintf(stderr, "\\%c", *s);
+	else if ((unsigned char) *s < 0x20)
+	    fprintf(stderr, "\\u%04x", *s);
+	else
+	    fputc(*s, stderr);
+    }
+    fputc('"', stderr);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    Timing Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Strip a leading 'time [-j]' from a parsed command line and
+ * remember how the line is to be reported. A quoted 'time' is
+ * an ordinary command.
+ * @pl: the parsed line; its first process loses the prefix
+ * @line: the command line string
+ * @return: the command line without the prefix;
+ * 	    NULL on syntax error */
+const char *time_prefix(PIPELINE *pl, const char *line)
+{
+    PS_INFO *ps = pl->ps;
+    int k = 1;
+
+    time_format = 0;
+    if (!pl->n_ps || !ps->argc || strcmp(ps->argv[0], "time"))
+	return line;
+
+    time_format = TIME_TEXT;
+    if (ps->argc > 1 && !strcmp(ps->argv[1], "-j"))
+	time_format = TIME_JSON, k++;
+    ps->argv += k;
+    ps->argc -= k;
+    if (!ps->argc && !ps->n_redirs && pl->n_ps > 1) {
+	time_format = 0;
+	fprintf(stderr, "-hsh: syntax error near unexpected token '|'\n");
+	return (const char *) NULL;
+    }
+
+    /* skip the prefix words in the line too */
+    while (k--) {
+	while (isspace((unsigned char) *line))
+	    line++;
+	while (*line && !isspace((unsigned char) *line))
+	    line++;
+    }
+    while (isspace((unsigned char) *line))
+	line++;
+
+    time_line = line;
+    time_taken = 0;
+    time_start(&time_self);
+    getrusage(RUSAGE_SELF, &time_self.ru);
+    return line;
+}
+
+/* Hand the report of the current line over to a job.
+ * @return: report format for the job; 0 if the line is not timed */
+int time_take(void)
+{
+    time_taken = 1;
+    return time_format;
+}
+
+/* Note when a process started.
+ * @p: the process */
+void time_start(PROCESS *p)
+{
+    clock_gettime(CLOCK_MONOTONIC, &p->start);
+    p->end = p->start;
+    memset(&p->ru, 0, sizeof(p->ru));
+}
+
+/* Note when a process finished; safe in a signal handler.
+ * @p: the process */
+void time_stop(PROCESS *p)
+{
+    clock_gettime(CLOCK_MONOTONIC, &p->end);
+}
+
+/* Report the resource usage of a timed job which is done, on
+ * stderr, as a table or as one line of JSON.
+ * @job: the job */
+void time_report(JOB *job)
+{
+    int i;
+    char label[16];
+    double real;
+    struct timespec start, end;
+    struct rusage total;
+    PROCESS *p;
+
+    if (!job->n_ps)
+	return;
+    memset(&total, 0, sizeof(total));
+    start = job->ps[0].start;
+    end = job->ps[0].end;
+
+    if (job->timed == TIME_JSON) {
+	fputs("{\"cmd\":", stderr);
+	print_json_string(job->cmd);
+	fputs(",\"stages\":[", stderr);
+    } else {
+	fprintf(stderr, "%-6s %8s %6s %10s %10s %10s %9s %7s %7s %8s %6s\n", "stage",
+		"pid", "status", "real", "user", "sys", "maxrss", "vcsw", "ivcsw",
+		"minflt", "majflt");
+    }
+
+    for (i = 0; i < job->n_ps; i++) {
+	p = &job->ps[i];
+	real = ts_diff(&p->end, &p->start);
+	ru_add(&total, &p->ru);
+	if (ts_diff(&p->start, &start) < 0)
+	    start = p->start;
+	if (ts_diff(&p->end, &end) > 0)
+	    end = p->end;
+
+	if (job->timed == TIME_JSON) {
+	    fprintf(stderr, "%s{\"pid\":%d,", i ? "," : "", (int) p->pid);
+	    print_json(p->status, real, &p->ru);
+	    fputc('}', stderr);
+	} else {
+	    snprintf(label, sizeof(label), "%d", i + 1);
+	    print_text(label, p->pid, p->status, real, &p->ru);
+	}
+    }
+
+    real = ts_diff(&end, &start);
+    p = &job->ps[job->n_ps-1];
+    if (job->timed == TIME_JSON) {
+	fputs("],\"total\":{", stderr);
+	print_json(p->status, real, &total);
+	fputs("}}\n", stderr);
+    } else {
+	print_text("total", 0, p->status, real, &total);
+    }
+}
+
+/* Finish the current line: if it was timed but no job reported
+ * it (a builtin, or a command not found), report hsh itself. */
+void time_end(void)
+{
+    struct rusage now;
+    JOB job;
+
+    if (time_format && !time_taken) {
+	time_stop(&time_self);
+	getrusage(RUSAGE_SELF, &now);
+	timersub(&now.ru_utime, &time_self.ru.ru_utime, &time_self.ru.ru_utime);
+	timersub(&now.ru_stime, &time_self.ru.ru_stime, &time_self.ru.ru_stime);
+	time_self.ru.ru_maxrss = now.ru_maxrss;
+	time_self.ru.ru_nvcsw = now.ru_nvcsw - time_self.ru.ru_nvcsw;
+	time_self.ru.ru_nivcsw = now.ru_nivcsw - time_self.ru.ru_nivcsw;
+	time_self.ru.ru_minflt = now.ru_minflt - time_self.ru.ru_minflt;
+	time_self.ru.ru_majflt = now.ru_majflt - time_self.ru.ru_majflt;
+	time_self.pid = getpid();
+	time_self.status = last_status;
+
+	memset(&job, 0, sizeof(job));
+	job.n_ps = 1;
+	job.ps = &time_self;
+	job.cmd = (char *) time_line;
+	job.timed = time_format;
+	time_report(&job);
+    }
+    time_format = 0;
+}
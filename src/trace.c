@@ -0,0 +1,196 @@
+/**
+ * This file implements phase tracing for Hank Shell, to tell hsh's
+ * own overhead apart from the run time of its children. When tracing
+ * is on (hsh -t, or HSH_TRACE set in the environment, or 'trace on'),
+ * each phase of reading and running a command line is timed with the
+ * monotonic clock and recorded in an in-memory ring buffer; slots are
+ * claimed with an atomic increment, so recording takes no lock. The
+ * 'trace' builtin dumps the buffer as Chrome trace-event JSON or
+ * summarizes it as per-phase percentiles.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	Global Data Structures			     //
+// 	     	 						     //
+//===================================================================//
+
+#define TRACE_RING_SIZE 65536	/* # of events kept; a power of 2 */
+
+/* A traced phase */
+typedef struct {
+    int phase;			/* TRACE_* */
+    uint64_t start;		/* monotonic clock, ns */
+    uint64_t dur;		/* duration, ns */
+} TRACE_EVENT;
+
+/* names of the phases, as shown in traces; the README maps the
+ * names of the first traces (path_abs2rel, ...) to these */
+static const char *phase_names[N_TRACE_PHASES] = {
+    "prompt_cwd", "prompt_get", "rl_gets", "execute_cmdline",
+    "parse_line", "expand_words", "io_redirect", "find_cmd",
+    "builtin", "spawn", "wait",
+};
+
+static int trace_on = 0;
+static TRACE_EVENT ring[TRACE_RING_SIZE];
+static uint64_t ring_head = 0;	/* # of events ever recorded */
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	Tracing Helper Functions		     //
+// 	     	 						     //
+//===================================================================//
+
+/* Current time of the monotonic clock in nanoseconds. */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Index of the oldest event still in the ring, and # of events. */
+static uint64_t ring_first(uint64_t *pn)
+{
+    uint64_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+
+    *pn = (head < TRACE_RING_SIZE) ? head : TRACE_RING_SIZE;
+    return head - *pn;
+}
+
+/* Compare two durations for qsort(). */
+static int dur_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Print the ring as Chrome trace-event JSON; load it in
+ * chrome://tracing or Perfetto. */
+static void dump_json(void)
+{
+    uint64_t i, n, first = ring_first(&n);
+    TRACE_EVENT *e;
+    int pid = (int) getpid();
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (i = 0; i < n; i++) {
+	e = &ring[(first + i) & (TRACE_RING_SIZE - 1)];
+	printf("%s\n{\"name\":\"%s\",\"cat\":\"hsh\",\"ph\":\"X\",\"ts\":%.3f,"
+		"\"dur\":%.3f,\"pid\":%d,\"tid\":%d}", i ? "," : "",
+		phase_names[e->phase], e->start / 1e3, e->dur / 1e3, pid, pid);
+    }
+    printf("\n]}\n");
+}
+
+/* Print count, total and percentiles of each phase in the ring,
+ * in microseconds. */
+static void dump_summary(void)
+{
+    static const size_t pcts[] = { 50, 90, 99 };
+    uint64_t i, n, first = ring_first(&n), total;
+    uint64_t *durs = (uint64_t *) arena_alloc((n + 1) * sizeof(uint64_t));
+    size_t k, m;
+    int phase;
+    TRACE_EVENT *e;
+
+    printf("%-16s %8s %12s %10s %10s %10s %10s\n", "phase", "count",
+	    "total us", "p50 us", "p90 us", "p99 us", "max us");
+    for (phase = 0; phase < N_TRACE_PHASES; phase++) {
+	for (i = m = total = 0; i < n; i++) {
+	    e = &ring[(first + i) & (TRACE_RING_SIZE - 1)];
+	    if (e->phase == phase) {
+		durs[m++] = e->dur;
+		total += e->dur;
+	    }
+	}
+	if (!m)
+	    continue;
+	qsort(durs, m, sizeof(uint64_t), dur_cmp);
+	printf("%-16s %8zu %12.1f", phase_names[phase], m, total / 1e3);
+	for (k = 0; k < sizeof(pcts) / sizeof(pcts[0]); k++)
+	    printf(" %10.1f", durs[(m - 1) * pcts[k] / 100] / 1e3);
+	printf(" %10.1f\n", durs[m-1] / 1e3);
+    }
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	    Tracing Interface			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Turn tracing on if HSH_TRACE is set in the environment. */
+void trace_init(void)
+{
+    const char *env = getenv("HSH_TRACE");
+
+    if (env && *env && strcmp(env, "0"))
+	trace_on = 1;
+}
+
+/* Turn tracing on or off.
+ * @on: non-zero to turn it on */
+void trace_enable(int on)
+{
+    trace_on = on;
+}
+
+/* Start timing a phase.
+ * @return: the start time; 0 if tracing is off */
+uint64_t trace_begin(void)
+{
+    return trace_on ? now_ns() : 0;
+}
+
+/* Record a phase in the ring buffer.
+ * @phase: TRACE_* phase
+ * @start: value returned by trace_begin(); nothing is
+ * 	   recorded if it is 0 */
+void trace_end(int phase, uint64_t start)
+{
+    uint64_t slot;
+    TRACE_EVENT *e;
+
+    if (!start)
+	return;
+    slot = __atomic_fetch_add(&ring_head, 1, __ATOMIC_ACQ_REL);
+    e = &ring[slot & (TRACE_RING_SIZE - 1)];
+    e->phase = phase;
+    e->start = start;
+    e->dur = now_ns() - start;
+}
+
+/* builtin trace [on|off|clear|json|summary]: control tracing or
+ * print what was traced; the summary is the default.
+ * @nargs: # of arguments in command line
+ * @args: command line argument buffer
+ * @return: 0 if no errors otherwise 1 */
+int builtin_trace(int nargs, char **args)
+{
+    const char *cmd = (nargs > 1) ? args[1] : "summary";
+
+    if (!strcmp(cmd, "on")) {
+	trace_on = 1;
+    } else if (!strcmp(cmd, "off")) {
+	trace_on = 0;
+    } else if (!strcmp(cmd, "clear")) {
+	__atomic_store_n(&ring_head, 0, __ATOMIC_RELEASE);
+    } else if (!strcmp(cmd, "json")) {
+	dump_json();
+    } else if (!strcmp(cmd, "summary")) {
+	if (!trace_on && !ring_head)
+	    fprintf(stderr, "-hsh: trace: tracing is off; try 'hsh -t', "
+		    "HSH_TRACE=1 or 'trace on'\n");
+	dump_summary();
+    } else {
+	fprintf(stderr, "-hsh: trace: usage: trace [on|off|clear|json|summary]\n");
+	return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,489 @@
+/**
+ * bench.c: microbenchmarks of the internals of hsh, each measured in
+ * isolation inside one process linked with the shell's own objects:
+ *
+ * 	list	  push/pop and find_node of list.c
+ * 	parse	  parse_line on lines of 10 to 10k tokens
+ * 	find_cmd  command lookup, cold (hash cleared) and hashed, with
+ * 		  the default path list and with a huge one
+ * 	complete  command name completion over 10k executables, with
+ * 		  the index rebuilt and with the index up to date
+ * 	expand	  expand_words on plain, $VAR, quoted and ~ words
+ * 	history	  history file of 1M entries: appending, mapping it,
+ * 		  the last 10 entries, prefix and substring search
+ * 	e2e	  execute_cmdline of one command and of N-stage pipelines
+ *
+ * Usage: ./hsh_bench [min ms per benchmark]	(make bench)
+ *
+ * Every benchmark doubles its iteration count until it runs for at
+ * least the given time (default 200 ms). Results are printed on stdout
+ * as JSON, one object per benchmark, so runs of different releases
+ * can be compared.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include <time.h>
+#include "hsh.h"
+
+extern struct List paths_list;
+
+/* a benchmark body: run the operation iters times */
+typedef void bench_fn(void *arg, long iters);
+
+static double min_ns = 200e6;	/* min run time of a benchmark */
+static int n_results = 0;
+
+/* Current time of the monotonic clock in nanoseconds */
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Run a benchmark long enough and print its result.
+ * @group: what is measured, e.g. "parse"
+ * @name: the case, e.g. "tokens=1000"
+ * @fn: the benchmark body
+ * @arg: argument of fn */
+static void run(const char *group, const char *name, bench_fn *fn, void *arg)
+{
+    long iters = 1;
+    double start, elapsed;
+
+    fn(arg, 1);				/* warm up */
+    while (1) {
+	start = now_ns();
+	fn(arg, iters);
+	elapsed = now_ns() - start;
+	if (elapsed >= min_ns || iters >= (1L << 40))
+	    break;
+	iters *= 2;
+    }
+    printf("%s\n  {\"group\": \"%s\", \"name\": \"%s\", \"iters\": %ld, "
+	    "\"ns_per_op\": %.1f}", n_results++ ? "," : "", group, name,
+	    iters, elapsed / iters);
+    fflush(stdout);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	    list.c: Linked List			     //
+// 	     	 						     //
+//===================================================================//
+
+static char list_data[] = "data";
+
+/* push then pop n elements */
+static void bench_push_pop(void *arg, long iters)
+{
+    int i, n = *(int *) arg;
+    struct List list;
+
+    list_init(&list);
+    while (iters--) {
+	for (i = 0; i < n; i++)
+	    push(&list, list_data);
+	for (i = 0; i < n; i++)
+	    pop(&list);
+    }
+    list_dtor(&list);
+}
+
+static int str_cmp(const void *a, const void *b)
+{
+    return strcmp((const char *) a, (const char *) b);
+}
+
+/* find the last of n elements */
+static void bench_find_node(void *arg, long iters)
+{
+    int i, n = *(int *) arg;
+    char **names = (char **) malloc(n * sizeof(char *));
+    struct List list;
+
+    list_init(&list);
+    for (i = 0; i < n; i++) {
+	names[i] = (char *) malloc(16);
+	snprintf(names[i], 16, "/dir/%d", i);
+	push_back(&list, names[i]);
+    }
+    while (iters--)
+	if (!find_node(&list, str_cmp, names[n-1]))
+	    abort();
+    list_dtor(&list);
+    for (i = 0; i < n; i++)
+	free(names[i]);
+    free(names);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	 	    parse.c: Parser			     //
+// 	     	 						     //
+//===================================================================//
+
+/* Build a command line of about n tokens: one pipe every 8 words
+ * and one redirection per process. */
+static char *make_line(int n)
+{
+    int i;
+    char *line = (char *) malloc(n * 12 + 16), *p = line;
+
+    for (i = 0; i < n; i++) {
+	if (i % 8 == 0)
+	    p += sprintf(p, i ? "| cmd " : "cmd ");
+	else if (i % 8 == 6)
+	    p += sprintf(p, "> out%d ", i++);
+	else
+	    p += sprintf(p, "a%d ", i);
+    }
+    *p = '\0';
+    return line;
+}
+
+static void bench_parse(void *arg, long iters)
+{
+    while (iters--) {
+	if (!parse_line((char *) arg))
+	    abort();
+	arena_reset();
+    }
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    hsh.c: Command Lookup			     //
+// 	     	 						     //
+//===================================================================//
+
+static char *lookup_args[] = { "true", NULL };
+
+/* look a command up with an empty hash table */
+static void bench_find_cold(void *arg, long iters)
+{
+    (void) arg;
+    while (iters--) {
+	hash_clear();
+	if (!find_cmd(&paths_list, lookup_args))
+	    abort();
+	arena_reset();
+    }
+}
+
+/* look a remembered command up */
+static void bench_find_hot(void *arg, long iters)
+{
+    (void) arg;
+    while (iters--) {
+	if (!find_cmd(&paths_list, lookup_args))
+	    abort();
+	arena_reset();
+    }
+}
+
+/* Make a huge path list: n_dirs empty directories, then one with
+ * n_files entries and a 'true' among them.
+ * @root: a fresh temporary directory */
+static void make_huge_paths(const char *root, int n_dirs, int n_files)
+{
+    int i, fd;
+    char path[PATH_SIZE];
+
+    list_init(&paths_list);
+    for (i = 0; i < n_dirs; i++) {
+	snprintf(path, sizeof(path), "%s/d%d", root, i);
+	mkdir(path, 0755);
+	push_back(&paths_list, dupstr(path));
+    }
+    snprintf(path, sizeof(path), "%s/big", root);
+    mkdir(path, 0755);
+    push_back(&paths_list, dupstr(path));
+    for (i = 0; i < n_files; i++) {
+	snprintf(path, sizeof(path), "%s/big/f%d", root, i);
+	if (-1 != (fd = open(path, O_WRONLY | O_CREAT, 0644)))
+	    close(fd);
+    }
+    snprintf(path, sizeof(path), "%s/big/true", root);
+    if (-1 != (fd = open(path, O_WRONLY | O_CREAT, 0755)))
+	close(fd);
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    complete.c: Command Completion		     //
+// 	     	 						     //
+//===================================================================//
+
+/* complete a prefix with the index rebuilt each time */
+static void bench_complete_cold(void *arg, long iters)
+{
+    uint32_t first;
+
+    while (iters--) {
+	complete_invalidate();
+	if (!complete_find((const char *) arg, &first))
+	    abort();
+    }
+}
+
+/* complete a prefix with the index up to date */
+static void bench_complete_hot(void *arg, long iters)
+{
+    uint32_t first;
+
+    while (iters--)
+	if (!complete_find((const char *) arg, &first))
+	    abort();
+}
+
+/* Make a path list of one directory with n executables.
+ * @root: a fresh temporary directory */
+static void make_exec_paths(const char *root, int n)
+{
+    int i, fd;
+    char path[PATH_SIZE];
+
+    list_init(&paths_list);
+    snprintf(path, sizeof(path), "%s/bin", root);
+    mkdir(path, 0755);
+    push_back(&paths_list, dupstr(path));
+    for (i = 0; i < n; i++) {
+	snprintf(path, sizeof(path), "%s/bin/cmd%05d", root, i);
+	if (-1 != (fd = open(path, O_WRONLY | O_CREAT, 0755)))
+	    close(fd);
+    }
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    expand.c: Word Expansion			     //
+// 	     	 						     //
+//===================================================================//
+
+/* expand a NULL terminated list of words */
+static void bench_expand(void *arg, long iters)
+{
+    char **words = (char **) arg;
+    int nargs;
+
+    while (iters--) {
+	if (!expand_words(words, &nargs))
+	    abort();
+	arena_reset();
+    }
+}
+
+/* Make a list of n copies of a word; expansion restores words,
+ * so they can be expanded again and again. */
+static char **make_words(const char *word, int n)
+{
+    int i;
+    char **words = (char **) malloc((n + 1) * sizeof(char *));
+
+    for (i = 0; i < n; i++)
+	words[i] = strdup(word);
+    words[n] = (char *) NULL;
+    return words;
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    history.c: History File			     //
+// 	     	 						     //
+//===================================================================//
+
+#define HIST_BENCH_ENTRIES 1000000
+
+/* a command line of the synthetic history */
+static void make_hist_line(char *buf, size_t size, long i)
+{
+    switch (i % 4) {
+	case 0: snprintf(buf, size, "git commit -m 'fix bug %ld'", i); break;
+	case 1: snprintf(buf, size, "make -j%ld", i % 64); break;
+	case 2: snprintf(buf, size, "cd /src/module%ld/include", i); break;
+	default: snprintf(buf, size, "grep -rn pattern%ld . | less", i); break;
+    }
+}
+
+/* append entries to the history file */
+static void bench_hist_add(void *arg, long iters)
+{
+    char line[64];
+
+    (void) arg;
+    while (iters--) {
+	make_hist_line(line, sizeof(line), iters);
+	hist_add(line);
+    }
+}
+
+/* map the history file and index its records */
+static void bench_hist_open(void *arg, long iters)
+{
+    while (iters--) {
+	hist_close();
+	if (hist_open((const char *) arg) || !hist_count())
+	    abort();
+    }
+}
+
+/* read the last 10 entries */
+static void bench_hist_last(void *arg, long iters)
+{
+    uint32_t i, n;
+    size_t sum = 0;
+
+    (void) arg;
+    while (iters--)
+	for (n = hist_count(), i = n - 10; i < n; i++)
+	    sum += strlen(hist_entry(i));
+    if (!sum)
+	abort();
+}
+
+/* search the history: arg is "p<prefix>" or "s<text>" */
+static void bench_hist_find(void *arg, long iters)
+{
+    const char *query = (const char *) arg;
+    const uint32_t *ids;
+
+    while (iters--)
+	if (!hist_find(query + 1, query[0] == 'p', &ids))
+	    abort();
+}
+
+//===================================================================//
+// 	     	 						     //
+// 	     	    	End-to-End Command Lines		     //
+// 	     	 						     //
+//===================================================================//
+
+/* run a command line through execute_cmdline() */
+static void bench_cmdline(void *arg, long iters)
+{
+    const char *line = (const char *) arg;
+    char *copy = (char *) malloc(strlen(line) + 1);
+
+    while (iters--) {
+	strcpy(copy, line);
+	execute_cmdline(copy);
+    }
+    free(copy);
+}
+
+/* Build 'true | true | ...' with n stages */
+static char *make_pipeline(int n)
+{
+    int i;
+    char *line = (char *) malloc(n * 7 + 1), *p = line;
+
+    for (i = 0; i < n; i++)
+	p += sprintf(p, i ? " | true" : "true");
+    return line;
+}
+
+int main(int argc, char **argv)
+{
+    int sizes[] = { 10, 100, 1000, 10000 };
+    int stages[] = { 2, 8, 32 };
+    const char *words[][2] = {		/* name, word */
+	{ "plain", "plain" }, { "var", "$HOME" },
+	{ "quoted", "\"a $USER b\"" }, { "tilde", "~/x" },
+    };
+    char name[64], root[] = "/tmp/hsh_bench.XXXXXX", *line, **wv;
+    char hist[] = "/tmp/hsh_bench_hist.XXXXXX";
+    int i, n;
+    long e;
+    struct List default_paths;
+
+    if (argc > 1)
+	min_ns = atof(argv[1]) * 1e6;
+
+    init_shell();
+    setenv("USER", "bench", 0);
+    printf("{\"benchmarks\": [");
+
+    for (i = 0; i < 2; i++) {
+	n = i ? 1000 : 10;
+	snprintf(name, sizeof(name), "push_pop n=%d", n);
+	run("list", name, bench_push_pop, &n);
+	snprintf(name, sizeof(name), "find_node n=%d", n);
+	run("list", name, bench_find_node, &n);
+    }
+
+    for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+	line = make_line(sizes[i]);
+	snprintf(name, sizeof(name), "tokens=%d", sizes[i]);
+	run("parse", name, bench_parse, line);
+	free(line);
+    }
+
+    run("find_cmd", "default path, cold", bench_find_cold, NULL);
+    run("find_cmd", "default path, hashed", bench_find_hot, NULL);
+    if (mkdtemp(root)) {
+	default_paths = paths_list;
+	make_huge_paths(root, 100, 20000);
+	run("find_cmd", "101 dirs + 20k files, cold", bench_find_cold, NULL);
+	run("find_cmd", "101 dirs + 20k files, hashed", bench_find_hot, NULL);
+	snprintf(name, sizeof(name), "rm -rf %s", root);
+	if (system(name))
+	    fprintf(stderr, "bench: could not remove %s\n", root);
+	list_clean(&paths_list);
+
+	mkdir(root, 0700);
+	make_exec_paths(root, 10000);
+	run("complete", "10k executables, rebuilt", bench_complete_cold, "cmd0");
+	run("complete", "10k executables, 1 match", bench_complete_hot, "cmd04242");
+	run("complete", "10k executables, 1000 matches", bench_complete_hot, "cmd04");
+	if (system(name))
+	    fprintf(stderr, "bench: could not remove %s\n", root);
+	list_clean(&paths_list);
+	paths_list = default_paths;
+	hash_clear();
+	complete_invalidate();
+    }
+
+    for (i = 0; i < (int) (sizeof(words) / sizeof(words[0])); i++) {
+	wv = make_words(words[i][1], 100);
+	snprintf(name, sizeof(name), "100 x %s", words[i][0]);
+	run("expand", name, bench_expand, wv);
+	for (n = 0; n < 100; n++)
+	    free(wv[n]);
+	free(wv);
+    }
+
+    if (-1 != (n = mkstemp(hist))) {
+	close(n);
+	unlink(hist);
+	setenv("HISTSIZE", "100000000", 1);
+	if (!hist_open(hist)) {
+	    run("history", "add", bench_hist_add, NULL);
+	    for (e = hist_count(); e < HIST_BENCH_ENTRIES; e++) {
+		make_hist_line(name, sizeof(name), e);
+		hist_add(name);
+	    }
+	    run("history", "open 1M entries", bench_hist_open, hist);
+	    run("history", "last 10 of 1M", bench_hist_last, NULL);
+	    run("history", "prefix of 1M", bench_hist_find, "pmake -j61");
+	    run("history", "substring of 1M", bench_hist_find, "spattern424243 ");
+	    run("history", "short substring of 1M", bench_hist_find, "s-j");
+	}
+	hist_close();
+	unlink(hist);
+    }
+
+    run("e2e", "true", bench_cmdline, "true");
+    run("e2e", "builtin pwd > /dev/null", bench_cmdline, "pwd > /dev/null");
+    for (i = 0; i < (int) (sizeof(stages) / sizeof(stages[0])); i++) {
+	line = make_pipeline(stages[i]);
+	snprintf(name, sizeof(name), "pipeline stages=%d", stages[i]);
+	run("e2e", name, bench_cmdline, line);
+	free(line);
+    }
+
+    printf("\n]}\n");
+    clean_shell();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#!/usr/bin/python3
+
+# This script measures the in-kernel copy of the cat builtin of src/hsh
+# against the cat found in the path list ('command cat', i.e. /bin/cat)
+# on a multi-GB file (default 2 GB), in the page cache after a first
+# read, for each way the data can go:
+#
+#     file>file   cat big > out          copy_file_range()
+#     file|pipe   cat big | wc -c        splice()
+#     pipe>file   cat big | cat > out    splice() (second cat measured)
+#     file>null   cat big > /dev/null    sendfile()
+#
+# and reports the throughput of each in GB/s, the median over runs. The
+# test file is written to a temporary directory next to this script
+# unless --dir is given; it needs room for two copies.
+#
+# Usage: ./cat_bench.py [--hsh path/to/hsh] [--size GB] [--runs N]
+#                       [--dir DIR] [--json]
+
+import os
+import statistics
+
+from shell_bench import bench_parser, parse_args, print_json, print_row, run_line, scratch_dir
+
+# case: command line, with CAT for the cat being measured
+CASES = {
+    "file>file": "CAT big > out",
+    "file|pipe": "CAT big | wc -c",
+    "pipe>file": "cat big | CAT > out",
+    "file>null": "CAT big > /dev/null",
+}
+
+
+def make_file(path, size):
+    """Write size bytes of incompressible data, 1 MB repeated."""
+    block = os.urandom(1 << 20)
+    with open(path, "wb") as f:
+        for _ in range(size >> 20):
+            f.write(block)
+
+
+def main():
+    parser = bench_parser("Compare the cat builtin of hsh with /bin/cat on a big file.",
+                          runs=3, scratch=True)
+    parser.add_argument("--size", type=float, default=2, help="file size in GB")
+    args = parse_args(parser)
+    hsh = args.hsh
+    size = int(args.size * (1 << 30))
+
+    results = {}
+    print_row(args, "%-10s %12s %12s %9s", "case", "builtin", "/bin/cat", "speedup")
+    with scratch_dir(args, "cat") as tmp:
+        make_file(os.path.join(tmp, "big"), size)
+        run_line(hsh, "command cat big > /dev/null", tmp)     # into the page cache
+        for name, line in CASES.items():
+            rate = {}
+            for cat in ("cat", "command cat"):
+                times = []
+                for _ in range(args.runs):
+                    if os.path.exists(os.path.join(tmp, "out")):
+                        os.unlink(os.path.join(tmp, "out"))
+                    times.append(run_line(hsh, line.replace("CAT", cat), tmp))
+                rate[cat] = size / statistics.median(times) / 1e9
+            results[name] = {
+                "builtin_gb_s": rate["cat"],
+                "bin_cat_gb_s": rate["command cat"],
+                "speedup": rate["cat"] / rate["command cat"],
+            }
+            print_row(args, "%-10s %7.2f GB/s %7.2f GB/s %8.2fx", name, rate["cat"],
+                      rate["command cat"], results[name]["speedup"])
+
+    print_json(args, results)
+
+
+if __name__ == "__main__":
+    main()
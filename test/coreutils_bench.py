@@ -0,0 +1,65 @@
+#!/usr/bin/python3
+
+# This script measures the utility fast paths of src/hsh: for each of
+# true, false, test, [, printf, cat, basename and dirname it runs a
+# script of N invocations (default 100k) twice, once with the builtin
+# and once prefixed with 'command', which finds the utility in the
+# path list and spawns it, and reports the time per invocation and
+# the speedup. Everything runs locally in a temporary directory.
+#
+# The spawned side takes about a millisecond per invocation, so the
+# default run lasts several minutes; --loops 10000 is quicker.
+#
+# Usage: ./coreutils_bench.py [--hsh path/to/hsh] [--loops N] [--json]
+
+import os
+
+from shell_bench import (bench_parser, parse_args, print_json, print_row, run_script,
+                         scratch_dir, write_script)
+
+# name: one invocation, as written in a script
+CASES = {
+    "true": "true",
+    "false": "false",
+    "test": "test -f data.txt -a 3 -gt 2",
+    "[": "[ -n \"$HOME\" ]",
+    "printf": "printf '%s=%d\\n' key 42",
+    "cat": "cat data.txt",
+    "basename": "basename /usr/include/stdio.h .h",
+    "dirname": "dirname /usr/include/stdio.h",
+}
+
+
+def main():
+    parser = bench_parser("Compare the utility builtins of hsh with spawning the utilities.")
+    parser.add_argument("--loops", type=int, default=100000,
+                        help="invocations per script")
+    args = parse_args(parser)
+    hsh = args.hsh
+
+    results = {}
+    print_row(args, "%-10s %13s %13s %9s", "utility", "builtin", "spawned", "speedup")
+    with scratch_dir(args, "coreutils") as tmp:
+        write_script(os.path.join(tmp, "data.txt"), ["a line of data"] * 4)
+        empty = run_script(hsh, write_script(os.path.join(tmp, "empty.sh"), [""]), tmp)
+        # 'false' fails on purpose: the status of the scripts is not checked
+        for name, cmd in CASES.items():
+            builtin = write_script(os.path.join(tmp, "builtin.sh"), [cmd] * args.loops)
+            spawned = write_script(os.path.join(tmp, "spawned.sh"),
+                                   ["command " + cmd] * args.loops)
+            t_builtin = max(run_script(hsh, builtin, tmp, check=False) - empty, 1e-9)
+            t_spawned = max(run_script(hsh, spawned, tmp, check=False) - empty, 1e-9)
+            results[name] = {
+                "builtin_us": t_builtin / args.loops * 1e6,
+                "spawned_us": t_spawned / args.loops * 1e6,
+                "speedup": t_spawned / t_builtin,
+            }
+            print_row(args, "%-10s %10.2f us %10.2f us %8.0fx", name,
+                      results[name]["builtin_us"], results[name]["spawned_us"],
+                      results[name]["speedup"])
+
+    print_json(args, results)
+
+
+if __name__ == "__main__":
+    main()
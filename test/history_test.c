@@ -0,0 +1,246 @@
+/**
+ * history_test.c: consistency of a history file shared by many
+ * instances of hsh, each a process appending to it concurrently
+ * through history.c:
+ *
+ * 	append	  W writers append L lines each while R readers follow
+ * 		  the file with hist_sync(); every reader must see every
+ * 		  line once, whole, and the lines of a writer in order
+ * 	compact	  the writers alone, each compacting the file every 100
+ * 		  lines, which keeps every entry; no line may be lost
+ * 		  (duplicates are counted, not errors)
+ * 	bounded	  the same with HISTSIZE small and no forced compaction;
+ * 		  the file must be compacted to at most 2 x HISTSIZE
+ * 		  whole lines, plus one per writer
+ *
+ * Usage: ./history_test [writers] [lines]	(make test_history)
+ *
+ * Prints one line per check and exits with status 1 on a failure.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include "hsh.h"
+
+#define N_READERS 4
+
+static int n_writers = 32, n_lines = 2000;
+static int compact_every = 0;		/* lines between compactions */
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+    failures += !ok;
+}
+
+/* Append lines as writer w; some lines are longer than a page, so
+ * readers may see them partly written. */
+static void writer(const char *path, int w)
+{
+    char line[6000];
+    int i, n, pad;
+
+    if (hist_open(path))
+	exit(EXIT_FAILURE);
+    for (i = 0; i < n_lines; i++) {
+	pad = (i % 97 == 0) ? 5000 : (i * 7 + w) % 40;
+	n = snprintf(line, sizeof(line), "w%d %d ", w, i);
+	memset(line + n, 'x', pad);
+	line[n + pad] = '\0';
+	if (hist_add(line) || (compact_every && i % compact_every == 0 && hist_compact()))
+	    exit(EXIT_FAILURE);
+    }
+    hist_close();
+    exit(EXIT_SUCCESS);
+}
+
+/* Parse a line of the test.
+ * @return: 0 if it is well-formed; -1 otherwise */
+static int parse(const char *line, int *w, int *i)
+{
+    int n;
+
+    if (sscanf(line, "w%d %d %n", w, i, &n) != 2 || *w < 0 || *w >= n_writers
+	    || *i < 0 || *i >= n_lines || strspn(line + n, "x") != strlen(line + n))
+	return -1;
+    return 0;
+}
+
+/* Follow the file until it holds every line, checking each new one.
+ * @return: 0 if the reader saw every line once, whole and in order */
+static void reader(const char *path)
+{
+    int *next = (int *) calloc(n_writers, sizeof(int));
+    uint32_t seen = 0, n;
+    int w, i, bad = 0;
+
+    if (hist_open(path))
+	exit(EXIT_FAILURE);
+    while (seen < (uint32_t) (n_writers * n_lines) && !bad) {
+	if (hist_sync())
+	    exit(EXIT_FAILURE);
+	for (n = hist_count(); seen < n && !bad; seen++) {
+	    if (parse(hist_entry(seen), &w, &i) || i != next[w]++)
+		bad = 1;
+	}
+    }
+    hist_close();
+    exit(bad || seen != (uint32_t) (n_writers * n_lines));
+}
+
+/* Start n readers or writers.
+ * @pids: set to their process ids */
+static void start(pid_t *pids, int n, const char *path, int readers)
+{
+    int k;
+
+    fflush(stdout);
+    for (k = 0; k < n; k++) {
+	if (0 == (pids[k] = fork())) {
+	    if (readers)
+		reader(path);
+	    writer(path, k);
+	}
+	if (pids[k] == -1)
+	    die_with_error("fork");
+    }
+}
+
+/* Wait for processes.
+ * @return: # of them which failed */
+static int wait_all(pid_t *pids, int n)
+{
+    int k, status, failed = 0;
+
+    for (k = 0; k < n; k++)
+	if (-1 == waitpid(pids[k], &status, 0) || !WIFEXITED(status) || WEXITSTATUS(status))
+	    failed++;
+    return failed;
+}
+
+/* W writers and R readers, no compaction */
+static void test_append(const char *path)
+{
+    pid_t writers[n_writers], readers[N_READERS];
+    int *next = (int *) calloc(n_writers, sizeof(int));
+    uint32_t k, n;
+    int w, i, bad = 0;
+    char what[128];
+
+    unlink(path);
+    setenv("HISTSIZE", "100000000", 1);
+    if (hist_open(path))		/* create it first */
+	exit(EXIT_FAILURE);
+    hist_close();
+    start(readers, N_READERS, path, 1);
+    start(writers, n_writers, path, 0);
+    check(!wait_all(writers, n_writers), "append: every writer succeeded");
+    check(!wait_all(readers, N_READERS), "append: readers saw every line once, whole, in order");
+
+    if (hist_open(path))
+	exit(EXIT_FAILURE);
+    n = hist_count();
+    for (k = 0; k < n && !bad; k++)
+	if (parse(hist_entry(k), &w, &i) || i != next[w]++)
+	    bad = 1;
+    snprintf(what, sizeof(what), "append: file holds %u of %d lines, in order per writer",
+	     n, n_writers * n_lines);
+    check(!bad && n == (uint32_t) (n_writers * n_lines), what);
+    hist_close();
+    free(next);
+}
+
+/* Check the final file of the writers.
+ * @dups: set to # of duplicate lines
+ * @return: # of lines missing; -1 if a line is not whole */
+static int check_file(const char *path, uint32_t *n, int *dups)
+{
+    char *seen = (char *) calloc(n_writers * n_lines, 1);
+    uint32_t k;
+    int w, i, missing = 0;
+
+    if (hist_open(path))
+	exit(EXIT_FAILURE);
+    *n = hist_count();
+    *dups = 0;
+    for (k = 0; k < *n; k++) {
+	if (parse(hist_entry(k), &w, &i)) {
+	    missing = -1;
+	    break;
+	}
+	*dups += seen[w * n_lines + i]++ != 0;
+    }
+    for (k = 0; missing != -1 && k < (uint32_t) (n_writers * n_lines); k++)
+	missing += !seen[k];
+    hist_close();
+    free(seen);
+    return missing;
+}
+
+/* W writers compacting the file over and over, keeping every line */
+static void test_compact(const char *path)
+{
+    pid_t writers[n_writers];
+    char what[128];
+    uint32_t n;
+    int dups, missing;
+
+    unlink(path);
+    setenv("HISTSIZE", "100000000", 1);
+    compact_every = 100;
+    start(writers, n_writers, path, 0);
+    check(!wait_all(writers, n_writers), "compact: every writer succeeded");
+    compact_every = 0;
+
+    missing = check_file(path, &n, &dups);
+    snprintf(what, sizeof(what), "compact: %u lines, %d missing, %d duplicates",
+	     n, missing, dups);
+    check(!missing, what);
+}
+
+/* W writers with a small HISTSIZE */
+static void test_bounded(const char *path)
+{
+    pid_t writers[n_writers];
+    char what[128];
+    uint32_t n, size = n_writers * n_lines / 8;
+    int dups, missing;
+
+    unlink(path);
+    snprintf(what, sizeof(what), "%u", size);
+    setenv("HISTSIZE", what, 1);
+    start(writers, n_writers, path, 0);
+    check(!wait_all(writers, n_writers), "bounded: every writer succeeded");
+
+    missing = check_file(path, &n, &dups);
+    snprintf(what, sizeof(what), "bounded: %u lines whole, HISTSIZE %u", n, size);
+    check(missing != -1 && n >= size && n < 2 * size + n_writers, what);
+}
+
+int main(int argc, char **argv)
+{
+    char path[] = "/tmp/hsh_history_test.XXXXXX";
+    char compact[PATH_SIZE];
+    int fd;
+
+    if (argc > 1)
+	n_writers = atoi(argv[1]);
+    if (argc > 2)
+	n_lines = atoi(argv[2]);
+    if (n_writers < 1 || n_lines < 1 || -1 == (fd = mkstemp(path))) {
+	fprintf(stderr, "Usage: %s [writers] [lines]\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    close(fd);
+    printf("%d writers x %d lines\n", n_writers, n_lines);
+
+    test_append(path);
+    test_compact(path);
+    test_bounded(path);
+
+    unlink(path);
+    snprintf(compact, sizeof(compact), "%s.compact", path);
+    unlink(compact);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,3 +1,380 @@
-#!/usr/bin/python
+#!/usr/bin/python3
 
-# This script is used to do test automation on src/hsh program 
+# This script is used to do test automation on src/hsh program:
+# behaviour tests which run the same script two ways and compare
+# what they print.
+#
+#   coreutils  each line of a case runs once with the utility builtins
+#              of hsh (test/[, printf, cat, basename and dirname) and
+#              once prefixed with 'command', which runs the coreutils
+#              binary; stdout and exit status of every line must match
+#   bash       a script runs once with hsh and once with bash, with
+#              the hsh-only operators '|N8', '|N8o' and '|[SIZE]'
+#              turned into a plain '|' for bash; stdout and the exit
+#              status after every line must match, sorted first for
+#              the cases of unordered sharded stages; lines which are
+#              syntax errors each run on their own with '-c', as bash
+#              gives up on the rest of a script after one
+#
+# Every case runs in a scratch directory holding a few files, in the
+# C locale unless the case says otherwise.
+#
+# Usage: ./hsh_test.py [--hsh path/to/hsh] [-k PATTERN] [-v]
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC = os.path.join(HERE, "..", "src")
+
+FILES = {
+    "a.txt": "one\ntwo\n\n\n\tthree\n",
+    "b.txt": "no newline at end",
+    "ctl.txt": "bell \a del \x7f high \xe9\n",
+    "empty.txt": "",
+}
+
+# name -> (environment, lines)
+COREUTILS = {
+    "test": ({}, [
+        "test",
+        "test abc",
+        "test ''",
+        "test -n ''",
+        "test -z ''",
+        "test -n",
+        "[ abc = abc ]",
+        "[ abc != abc ]",
+        "[ 1 -lt 2 ]",
+        "[ -5 -ge -5 ]",
+        "[ 007 -eq 7 ]",
+        "[ ' 12' -gt 3 ]",
+        "[ 1x -eq 1 ]",
+        "[ 2 -gt ]",
+        "[ 1 -eq 1",
+        "[ ! -e nothing ]",
+        "[ -d . ]",
+        "[ -f a.txt ]",
+        "[ -s empty.txt ]",
+        "[ -s a.txt ]",
+        "[ -r a.txt -a -w a.txt ]",
+        "[ -x a.txt -o -f b.txt ]",
+        "[ a.txt -ef a.txt ]",
+        "[ '(' 1 = 1 ')' ]",
+        "[ ! '(' a = b -o c = c ')' ]",
+        "test 1 = 1 -a 2 = 3 -o 4 = 4",
+        "test ! ! x",
+        "test -l abc -eq 3",
+        "test 3 -eq -l abc",
+        "test -l '' -lt -l x",
+        "test -l abc = 3",
+        "test = = =",
+        "test -t 5",
+        "test x -lt 1",
+    ]),
+    "printf": ({}, [
+        "printf 'plain text'",
+        "printf '%s|' a b c",
+        "printf '%s %s|' a b c",
+        "printf '%d %i %o %u %x %X|' 42 -7 8 9 255 255",
+        "printf '%5d|%-5d|%05d|%+d|% d|' 1 2 3 4 5",
+        "printf '%*d|%-*.*f|' 6 7 8 2 3.14159",
+        "printf '%.3s|%10s|%-10s|' abcdef right left",
+        "printf '%c%c|' hello ''",
+        "printf '%d|' \"'A\" 0x1f 010",
+        "printf '%d|' 12abc",
+        "printf '%d|' abc",
+        "printf '%f %e %g %G|' 1.5 1.5 0.0001 1e20",
+        "printf '%a|' 1",
+        "printf '%%|%s|' x",
+        "printf '%z'",
+        "printf '%'",
+        "printf 'a\\tb\\nc\\\\d\\'",
+        "printf '\\101\\x42\\x4z|'",
+        "printf 'x\\cy'",
+        "printf 'before\\x'",
+        "printf '%b|' 'a\\tb' '\\0101' '\\x41' 'stop\\cgone' next",
+        "printf '%q|' '' plain 'two words' \"it's\" 'a\"b' '$x' '#x' 'x#' '~' 'x~' '{' '{}'",
+        "printf '%q|' \"a'b c\" \"'\" \"a'b\\\"\" 'semi;colon' 'back\\slash'",
+        "printf '%q|' \"$(printf 'a\\tb\\001')\" \"$(printf '\\001x')\"",
+        "printf '%q|' \"$(printf 'tab\\tx')\" \"$(printf \"it's\\001\")\"",
+        "printf '%q|' \"$(printf 'caf\\303\\251')\"",
+        "printf '%5q|' x",
+        "printf '%-q|' x",
+        "printf '\\u0024\\u0040\\u0060|'",
+        "printf '\\u00e9\\u20ac\\U0001F600\\U00110000|'",
+        "printf '%b|' '\\u00e9'",
+        "printf 'x\\u00e'",
+        "printf 'x\\u0041'",
+        "printf 'x\\ud800'",
+        "printf -- '%s|' a",
+    ]),
+    "printf_utf8": ({"LC_ALL": "C.UTF-8"}, [
+        "printf '%q|' \"$(printf 'caf\\303\\251')\" \"$(printf '\\303')\" \"$(printf 'a\\303\\251\\001')\"",
+        "printf '\\u00e9\\u07ff\\u20ac\\U0001F600\\U00110000|'",
+        "printf '%b|' '\\u00e9'",
+    ]),
+    "cat": ({}, [
+        "cat a.txt b.txt",
+        "cat empty.txt",
+        "cat nothing a.txt",
+        "cat -n a.txt b.txt",
+        "cat -b a.txt",
+        "cat -s a.txt",
+        "cat -E a.txt",
+        "cat -T a.txt",
+        "cat -v ctl.txt",
+        "cat -A a.txt ctl.txt",
+        "cat -ns a.txt",
+        "cat -bE a.txt",
+        "cat - < a.txt",
+        "cat < b.txt",
+        "printf 'x\\ny\\n' | cat -n - a.txt",
+        "cat -u a.txt",
+        "cat -z a.txt",
+        "cat .",
+    ]),
+    "basename": ({}, [
+        "basename /usr/lib/libc.so",
+        "basename /usr/lib/",
+        "basename ///",
+        "basename ''",
+        "basename file.txt .txt",
+        "basename .txt .txt",
+        "basename dir/file.txt xt",
+        "basename -s .c a.c b.c/ d.h",
+        "basename -a one/x two/y",
+        "basename -z a/b",
+        "basename --suffix=.sh run.sh",
+        "basename --suffix .sh --zero a.sh b/c.sh",
+        "basename --multiple x/y z",
+        "basename --bogus x",
+        "basename",
+        "basename a b c",
+    ]),
+    "dirname": ({}, [
+        "dirname /usr/lib/libc.so",
+        "dirname /usr/lib/",
+        "dirname usr",
+        "dirname /",
+        "dirname //",
+        "dirname ///a//b//",
+        "dirname ''",
+        "dirname a/b c/d e",
+        "dirname -z a/b",
+        "dirname --zero a/b c",
+        "dirname",
+    ]),
+}
+
+# name -> (mode, lines); mode is "script", "sorted" (output sorted
+# before it is compared) or "lines" (each line on its own with -c)
+BASH = {
+    "parse_words": ("script", [
+        "echo a   b\tc",
+        "echo 'single  quoted' \"double  quoted\" mixed'q'\"d\"",
+        "echo \"nested 'single' in double\" 'double \"in\" single'",
+        "echo back\\ slash \\'q\\' \\\"d\\\" \\\\",
+        "echo \"in double: \\\" \\\\ \\$ \\`\"",
+        "echo '' \"\" x",
+        "echo a#b # a comment",
+        "# only a comment",
+        "",
+        "echo '|' '>' \"<\" '&' x",
+    ]),
+    "parse_operators": ("script", [
+        "echo glued|tr a-z A-Z",
+        "echo out>glued.txt",
+        "cat<glued.txt",
+        "echo a|cat|cat -n|tr -d ' '",
+        "echo one >one.txt two",
+        "cat one.txt",
+        "echo x>bg.txt&",
+        "wait",
+        "cat bg.txt",
+        "echo x&>amp.txt",
+        "cat amp.txt",
+    ]),
+    "parse_errors": ("lines", [
+        "| echo x",
+        "echo x | | cat",
+        "echo x >",
+        "echo x >> > y",
+        "echo x < | cat",
+        "echo 'unterminated",
+        "echo \"unterminated",
+        "& echo x",
+    ]),
+    "expansion": ("script", [
+        "export GREETING='hello   world'",
+        "echo $GREETING ${GREETING}! \"$GREETING\" '$GREETING'",
+        "echo $GREETING | wc -w",
+        "echo pre${GREETING}post \"pre${GREETING}post\"",
+        "echo $UNSET_VARIABLE_X. \"$UNSET_VARIABLE_X\". ${UNSET_VARIABLE_X}.",
+        "echo ~ ~/sub \"~\" '~' x~",
+        "echo *.txt",
+        "echo [ab].txt ?.txt",
+        "echo nomatch*.zz \"*.txt\" '*.txt' \\*.txt",
+        "echo $(echo sub   stitution) \"$(echo a   b)\"",
+        "echo $(echo $(echo nested))",
+        "false",
+        "echo $? $?",
+        "echo \\$HOME '$HOME' \"\\$HOME\"",
+        "cat ~/a.txt",
+        "export EMPTY=",
+        "echo x$EMPTY\"$EMPTY\"y",
+    ]),
+    "redirections": ("script", [
+        "echo out > r.txt",
+        "echo more >> r.txt",
+        "cat r.txt",
+        "wc -l < r.txt",
+        "ls a.txt nothing > o.txt 2> e.txt",
+        "cat o.txt e.txt",
+        "ls a.txt nothing &> both.txt",
+        "sort both.txt",
+        "ls a.txt nothing &>> both.txt",
+        "wc -l < both.txt",
+        "ls a.txt nothing > dup.txt 2>&1",
+        "sort dup.txt",
+        "ls nothing 2>&1 > /dev/null | wc -l",
+        "ls a.txt 1>&2",
+        "echo to stderr 1>&2",
+        "cat 3< a.txt <&3",
+        "cat 4< b.txt 0<&4",
+        "echo x >&5",
+        "echo x 2>&7",
+        "cat < nothing",
+        "echo x > /nonexistent/dir/file",
+        "wc < nothing",
+        "wc -l > /nonexistent/dir/file",
+        "echo a | wc -l < nothing",
+    ]),
+    "pipesize": ("script", [
+        "seq 1 20000 |[1M] wc -l",
+        "cat a.txt |[64k] cat -n",
+        "seq 1 3000 |[4096] tail -n 2 |[1m] cat",
+        "seq 1 100000 |[2M] sort -rn |[512k] head -n 3",
+    ]),
+    "shard": ("sorted", [
+        "seq 1 2000 |N4 awk '{ print $1 * 2 }'",
+        "seq 1 500 |N3 awk /7/",
+        "cat a.txt b.txt |N2 tr a-z A-Z",
+        "seq 1 20000 |N8 cat | wc -l",
+        "printf 'no newline' |N2 cat",
+    ]),
+    "shard_ordered": ("script", [
+        "seq 1 5000 |N4o awk '{ print $1 * 2 }'",
+        "seq 1 300 |N2o sed s/1/one/",
+        "cat a.txt |N3o cat",
+        "seq 1 20000 |N8o cat | md5sum",
+        "printf 'x\\ny' |N2o cat",
+        "seq 1 50 |N1o cat |N2 cat | wc -l",
+    ]),
+}
+
+# operators of hsh which bash does not know, and their bash form
+HSH_ONLY = re.compile(r"\|(N[0-9]+o?|\[[0-9]+[kKmMgG]?\])")
+
+
+def run_script(shell, lines, cwd, env):
+    """Run lines as a script, each followed by its exit status;
+    return what it printed."""
+    script = os.path.join(cwd, "case.sh")
+    with open(script, "w") as f:
+        for line in lines:
+            f.write("%s\necho '[status' $? ']'\n" % line)
+    proc = subprocess.run([shell, script], cwd=cwd, env=env, stdin=subprocess.DEVNULL,
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, timeout=30)
+    return proc.stdout
+
+
+def run_line(shell, line, cwd, env):
+    """Run a line with -c; return what it printed and its exit status."""
+    proc = subprocess.run([shell, "-c", line], cwd=cwd, env=env, stdin=subprocess.DEVNULL,
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, timeout=30)
+    return proc.stdout + b"[status %d ]\n" % proc.returncode
+
+
+def make_files(tmp):
+    """Write the files the cases use."""
+    for name, data in FILES.items():
+        with open(os.path.join(tmp, name), "wb") as f:
+            f.write(data.encode("latin-1"))
+
+
+def check(name, got, want, verbose):
+    """Compare the output of a case with the expected one.
+    @return: True if they match"""
+    if got == want:
+        if verbose:
+            print("ok    %s" % name)
+        return True
+    print("FAIL  %s" % name)
+    got, want = got.splitlines(), want.splitlines()
+    for k in range(max(len(got), len(want))):
+        g = got[k] if k < len(got) else b"<none>"
+        w = want[k] if k < len(want) else b"<none>"
+        if g != w:
+            print("      line %d: got %r, expected %r" % (k + 1, g, w))
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Behaviour tests of hsh against coreutils and bash.")
+    parser.add_argument("--hsh", default=os.path.join(SRC, "hsh"))
+    parser.add_argument("-k", metavar="PATTERN", default="",
+                        help="only run cases whose name contains PATTERN")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+    hsh = os.path.abspath(args.hsh)
+
+    failed = total = 0
+    with tempfile.TemporaryDirectory(prefix="hsh_test.") as tmp:
+        make_files(tmp)
+        base = {"PATH": os.environ.get("PATH", "/usr/bin:/bin"), "HOME": tmp,
+                "LC_ALL": "C"}
+        for name, (env, lines) in COREUTILS.items():
+            if args.k not in name:
+                continue
+            env = dict(base, **env)
+            for k, line in enumerate(lines):
+                total += 1
+                got = run_script(hsh, [line], tmp, env)
+                want = run_script(hsh, ["command " + line], tmp, env)
+                if not check("%s %d: %s" % (name, k + 1, line), got, want, args.verbose):
+                    failed += 1
+
+        bash = shutil.which("bash")
+        for name, (mode, lines) in BASH.items():
+            if args.k not in name or not bash:
+                continue
+            total += 1
+            if mode == "lines":
+                got = b"".join(run_line(hsh, line, tmp, base) for line in lines)
+                want = b"".join(run_line(bash, HSH_ONLY.sub("|", line), tmp, base)
+                                for line in lines)
+            else:
+                got = run_script(hsh, lines, tmp, base)
+                want = run_script(bash, [HSH_ONLY.sub("|", line) for line in lines],
+                                  tmp, base)
+            if mode == "sorted":
+                got = b"\n".join(sorted(got.splitlines()))
+                want = b"\n".join(sorted(want.splitlines()))
+            if not check(name, got, want, args.verbose):
+                failed += 1
+        if not bash:
+            print("bash not found: skipped the cases compared with bash")
+
+    print("%d of %d cases passed" % (total - failed, total))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+/**
+ * parse_bench.c: compare the single-pass parser of hsh (parse.c)
+ * against the old strtok tokenizer followed by strcmp scans for
+ * pipes and redirections, on command lines of 10 to 10k tokens.
+ *
+ * Usage: ./parse_bench [iterations]
+ *
+ * Lines look like 'cmd a1 a2 ... | cmd a1 ... > out', one pipe every
+ * 8 words and one redirection per process; the mean time of parsing
+ * one line is reported in microseconds.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include <time.h>
+#include "hsh.h"
+
+/* the arena reports malloc failure through the shell */
+void die_with_error(char *msg)
+{
+    perror(msg);
+    exit(EXIT_FAILURE);
+}
+
+/* Current time of the monotonic clock in microseconds */
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Build a command line of about n tokens */
+static char *make_line(int n)
+{
+    int i;
+    char *line = (char *) malloc(n * 12 + 16), *p = line;
+
+    for (i = 0; i < n; i++) {
+	if (i % 8 == 0)
+	    p += sprintf(p, i ? "| cmd " : "cmd ");
+	else if (i % 8 == 6)
+	    p += sprintf(p, "> out%d ", i++);
+	else
+	    p += sprintf(p, "a%d ", i);
+    }
+    *p = '\0';
+    return line;
+}
+
+/* The old parser: strtok, then one strcmp scan for syntax errors,
+ * one to count processes, one to split them and one per process
+ * to strip redirections. */
+static int legacy_parse(char *line, char **args, PS_INFO *ps, REDIR *redirs)
+{
+    int i, j, n = 0, nps = 1, head = 0, nr = 0;
+    char *tok;
+
+    for (tok = strtok(line, " \t"); tok; tok = strtok(NULL, " \t"))
+	args[n++] = tok;
+    args[n] = NULL;
+
+    for (i = 0; i < n - 1; i++)
+	if ((!strcmp(args[i], "|") && !strcmp(args[i+1], "|")) ||
+	    (!strcmp(args[i], ">") && !strcmp(args[i+1], "|")) ||
+	    (!strcmp(args[i], "<") && !strcmp(args[i+1], ">")))
+	    return -1;
+    for (i = 0; args[i]; i++)
+	if (!strcmp(args[i], "|"))
+	    nps++;
+    for (i = 0, j = 0; args[i]; i++)
+	if (!strcmp(args[i], "|")) {
+	    ps[j].argc = i - head;
+	    ps[j++].argv = &args[head];
+	    args[i] = NULL;
+	    head = i + 1;
+	}
+    ps[j].argc = i - head;
+    ps[j].argv = &args[head];
+
+    for (j = 0; j < nps; j++)
+	for (i = 0; i < ps[j].argc - 1; ) {
+	    if (strcmp(ps[j].argv[i], ">") && strcmp(ps[j].argv[i], "<") &&
+		strcmp(ps[j].argv[i], ">>") && strcmp(ps[j].argv[i], "2>")) {
+		i++;
+		continue;
+	    }
+	    redirs[nr++].path = ps[j].argv[i+1];
+	    memmove(&ps[j].argv[i], &ps[j].argv[i+2],
+		    (ps[j].argc - i - 1) * sizeof(char *));
+	    ps[j].argc -= 2;
+	}
+    return nps;
+}
+
+int main(int argc, char **argv)
+{
+    int sizes[] = { 10, 100, 1000, 10000 };
+    int iters = (argc > 1) ? atoi(argv[1]) : 2000;
+    int s, i, n;
+    char *line, *copy, **args;
+    PS_INFO *ps;
+    REDIR *redirs;
+    double t_legacy, t_new, start;
+
+    printf("%8s %14s %14s\n", "tokens", "strtok us", "single-pass us");
+    for (s = 0; s < (int) (sizeof(sizes) / sizeof(sizes[0])); s++) {
+	n = sizes[s];
+	line = make_line(n);
+	copy = (char *) malloc(strlen(line) + 1);
+	args = (char **) malloc((2 * n + 2) * sizeof(char *));
+	ps = (PS_INFO *) malloc((n + 1) * sizeof(PS_INFO));
+	redirs = (REDIR *) malloc((n + 1) * sizeof(REDIR));
+
+	start = now_us();
+	for (i = 0; i < iters; i++) {
+	    strcpy(copy, line);	    /* strtok modifies the line */
+	    legacy_parse(copy, args, ps, redirs);
+	}
+	t_legacy = (now_us() - start) / iters;
+
+	start = now_us();
+	for (i = 0; i < iters; i++) {
+	    strcpy(copy, line);	    /* same copy cost for fairness */
+	    if (!parse_line(copy))
+		return EXIT_FAILURE;
+	    arena_reset();
+	}
+	t_new = (now_us() - start) / iters;
+
+	printf("%8d %14.2f %14.2f\n", n, t_legacy, t_new);
+	free(line); free(copy); free(args); free(ps); free(redirs);
+    }
+
+    arena_clean();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#!/usr/bin/python3
+
+# This script measures start-to-first-byte latency of long pipelines
+# in src/hsh: the time from starting 'echo x | cat | ... | cat' until
+# the first byte of output arrives, for 2 to 500 stages.
+#
+# Each number is the best over runs.
+#
+# Usage: ./pipeline_bench.py [--hsh path/to/hsh] [--runs N] [--json]
+
+import subprocess
+import time
+
+from shell_bench import bench_parser, parse_args, print_json, print_row
+
+STAGES = [2, 5, 10, 50, 100, 200, 500]
+
+
+def first_byte_latency(hsh, n_stages):
+    """Return seconds from launching hsh until the first output byte."""
+    cmd = "echo x" + " | cat" * (n_stages - 1)
+    start = time.perf_counter()
+    proc = subprocess.Popen([hsh, "-c", cmd], stdout=subprocess.PIPE)
+    proc.stdout.read(1)
+    latency = time.perf_counter() - start
+    proc.stdout.read()
+    proc.wait()
+    return latency
+
+
+def main():
+    args = parse_args(bench_parser(
+        "Measure the first byte latency of long pipelines of hsh.", runs=10))
+
+    results = {}
+    print_row(args, "%8s %14s %16s", "stages", "first byte ms", "per stage us")
+    for n in STAGES:
+        best = min(first_byte_latency(args.hsh, n) for _ in range(args.runs))
+        results[n] = {"first_byte_ms": best * 1e3, "per_stage_us": best * 1e6 / n}
+        print_row(args, "%8d %14.2f %16.1f", n, best * 1e3, best * 1e6 / n)
+
+    print_json(args, results)
+
+
+if __name__ == "__main__":
+    main()
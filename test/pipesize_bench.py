@@ -0,0 +1,83 @@
+#!/usr/bin/python3
+
+# This script measures the throughput of src/hsh pipelines with the
+# default 64 KB pipes, with 1 MB pipes ('pipesize 1M') and with pipes
+# grown as they fill up ('pipesize auto'), on two GB-scale workloads:
+#
+#     zero|wc     head -c 4G /dev/zero | wc -c
+#     gunzip|grep gzip -dc log.gz | grep -c ERROR   (1 GB of log lines)
+#
+# For each it reports the throughput in GB/s of data through the pipe
+# and the context switches of the pipeline (from 'time -j'); both are
+# the median over runs. The log is written to a temporary directory
+# next to this script unless --dir is given.
+#
+# Usage: ./pipesize_bench.py [--hsh path/to/hsh] [--size GB] [--runs N]
+#                            [--dir DIR] [--json]
+
+import gzip
+import json
+import os
+import statistics
+import subprocess
+import time
+
+from shell_bench import bench_parser, parse_args, print_json, print_row, scratch_dir
+
+# mode: the pipesize setting
+MODES = {"64K": "0", "1M": "1M", "auto": "auto"}
+
+
+def run_timed(hsh, setting, line, cwd):
+    """Run a pipeline with hsh; return (seconds, context switches)."""
+    script = "pipesize %s\ntime -j %s\n" % (setting, line)
+    start = time.perf_counter()
+    proc = subprocess.run([hsh, "-c", script], cwd=cwd, stdin=subprocess.DEVNULL,
+                          stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, check=True)
+    elapsed = time.perf_counter() - start
+    report = json.loads(proc.stderr.decode().strip().splitlines()[-1])
+    return elapsed, report["total"]["vcsw"] + report["total"]["ivcsw"]
+
+
+def make_log(path, size):
+    """Write about size bytes of log lines, gzipped."""
+    lines = "".join("2026-10-17 12:00:%02d %s request %d served in %d ms\n" %
+                    (i % 60, "ERROR" if i % 97 == 0 else "INFO", i, i % 250)
+                    for i in range(20000)).encode()
+    with gzip.open(path, "wb", compresslevel=1) as f:
+        for _ in range(max(size // len(lines), 1)):
+            f.write(lines)
+    return (size // len(lines)) * len(lines)
+
+
+def main():
+    parser = bench_parser("Compare pipe capacities of hsh on GB-scale pipelines.",
+                          runs=3, scratch=True)
+    parser.add_argument("--size", type=float, default=1, help="log size in GB")
+    args = parse_args(parser)
+    hsh = args.hsh
+
+    results = {}
+    print_row(args, "%-12s %6s %10s %12s", "workload", "pipes", "GB/s", "ctx switches")
+    with scratch_dir(args, "pipesize") as tmp:
+        log_size = make_log(os.path.join(tmp, "log.gz"), int(args.size * (1 << 30)))
+        workloads = {
+            "zero|wc": ("head -c 4G /dev/zero | wc -c", 4 << 30),
+            "gunzip|grep": ("gzip -dc log.gz | grep -c ERROR", log_size),
+        }
+        for name, (line, size) in workloads.items():
+            results[name] = {}
+            for mode, setting in MODES.items():
+                runs = [run_timed(hsh, setting, line, tmp) for _ in range(args.runs)]
+                results[name][mode] = {
+                    "gb_s": size / statistics.median(t for t, _ in runs) / 1e9,
+                    "ctx_switches": statistics.median(c for _, c in runs),
+                }
+                print_row(args, "%-12s %6s %10.2f %12d", name, mode,
+                          results[name][mode]["gb_s"], results[name][mode]["ctx_switches"])
+
+    print_json(args, results)
+
+
+if __name__ == "__main__":
+    main()
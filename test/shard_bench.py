@@ -0,0 +1,67 @@
+#!/usr/bin/python3
+
+# This script measures the scaling of sharded pipeline stages of
+# src/hsh: a CPU-bound line filter is run as one process, then as N
+# copies, unordered ('|N') and in order ('|No'), for N up to the
+# number of online CPUs (or --max):
+#
+#     cat data |N4 awk '{ ... }' | wc -l
+#
+# For each it reports the throughput in MB/s of input through the
+# stage and the speedup over one process, the median over runs. The
+# data is written to a temporary directory next to this script unless
+# --dir is given.
+#
+# Usage: ./shard_bench.py [--hsh path/to/hsh] [--size MB] [--max N]
+#                         [--runs N] [--dir DIR] [--json]
+
+import os
+import statistics
+
+from shell_bench import bench_parser, parse_args, print_json, print_row, run_line, scratch_dir
+
+# a filter spending some microseconds of CPU on every line
+FILTER = "awk '{ s = 0; for (i = 0; i < 50; i++) s += length($0) * i; print s, $1 }'"
+
+
+def make_data(path, size):
+    """Write about size bytes of numbered lines."""
+    with open(path, "w") as f:
+        i = 0
+        while f.tell() < size:
+            f.write("".join("%d some words of a log line\n" % n for n in range(i, i + 10000)))
+            i += 10000
+        return f.tell()
+
+
+def main():
+    parser = bench_parser("Compare a pipeline stage run as one process and as N copies.",
+                          runs=3, scratch=True)
+    parser.add_argument("--size", type=float, default=64, help="data size in MB")
+    parser.add_argument("--max", type=int, default=os.cpu_count() or 1)
+    args = parse_args(parser)
+    hsh = args.hsh
+
+    results = {}
+    print_row(args, "%-8s %10s %9s", "stage", "MB/s", "speedup")
+    with scratch_dir(args, "shard") as tmp:
+        size = make_data(os.path.join(tmp, "data"), int(args.size * (1 << 20)))
+        stages = {"1": "|"}
+        n = 2
+        while n <= max(args.max, 2):
+            stages["N%d" % n] = "|N%d" % n
+            stages["N%do" % n] = "|N%do" % n
+            n *= 2
+        for name, pipe in stages.items():
+            line = "cat data %s %s | wc -l" % (pipe, FILTER)
+            runs = [run_line(hsh, line, tmp) for _ in range(args.runs)]
+            results[name] = {"mb_s": size / statistics.median(runs) / (1 << 20)}
+            results[name]["speedup"] = results[name]["mb_s"] / results["1"]["mb_s"]
+            print_row(args, "%-8s %10.1f %8.2fx", name, results[name]["mb_s"],
+                      results[name]["speedup"])
+
+    print_json(args, results)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,227 @@
+#!/usr/bin/python3
+
+# This script compares src/hsh with dash and bash on scripted workloads
+# and reports, for each shell: startup time, commands per second on
+# many tiny commands and on redirection-heavy command lists, latency
+# of the pipeline in test_cases.txt and peak RSS. Everything runs
+# locally in a temporary directory.
+#
+# With --baseline FILE the hsh results are checked against a previous
+# run saved with --save FILE; the script exits with status 1 if hsh is
+# slower (or bigger) by more than --threshold (default 25%).
+#
+# Usage: ./shell_bench.py [--hsh path/to/hsh] [--runs N] [--lines N]
+#                         [--json] [--save FILE] [--baseline FILE]
+#                         [--threshold FRACTION]
+#
+# The other benchmarks of this directory import their scaffolding from
+# here: the common options, running hsh on a script or a command line,
+# a scratch directory and printing results as a table or as JSON.
+
+import argparse
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC = os.path.join(HERE, "..", "src")
+
+# metric: True if higher is better
+METRICS = {
+    "startup_ms": False,
+    "tiny_cmds_per_sec": True,
+    "redir_cmds_per_sec": True,
+    "pipeline_ms": False,
+    "peak_rss_kb": False,
+}
+
+
+def bench_parser(description, runs=None, scratch=False):
+    """Return an argument parser with the options of every benchmark:
+    --hsh, --runs (unless runs is None) and --json, plus --dir for the
+    ones writing big scratch files."""
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument("--hsh", default=os.path.join(SRC, "hsh"))
+    if runs is not None:
+        parser.add_argument("--runs", type=int, default=runs)
+    if scratch:
+        parser.add_argument("--dir", default=HERE,
+                            help="where the scratch directory goes")
+    parser.add_argument("--json", action="store_true")
+    return parser
+
+
+def parse_args(parser):
+    """Parse the command line; --hsh is made absolute."""
+    args = parser.parse_args()
+    args.hsh = os.path.abspath(args.hsh)
+    return args
+
+
+def scratch_dir(args, name):
+    """A temporary directory for a benchmark, removed when done."""
+    return tempfile.TemporaryDirectory(prefix="hsh_%s_bench." % name,
+                                       dir=getattr(args, "dir", None))
+
+
+def run_script(shell, script, cwd, check=True):
+    """Run a script file with a shell; return its run time in seconds.
+    With check, a failing script ends the benchmark."""
+    start = time.perf_counter()
+    status = subprocess.call([shell, script], cwd=cwd, stdin=subprocess.DEVNULL,
+                             stdout=subprocess.DEVNULL)
+    elapsed = time.perf_counter() - start
+    if check and status:
+        sys.exit("%s %s: exit status %d" % (shell, script, status))
+    return elapsed
+
+
+def run_line(hsh, line, cwd):
+    """Run a command line with hsh; return its run time in seconds."""
+    start = time.perf_counter()
+    subprocess.check_call([hsh, "-c", line], cwd=cwd, stdin=subprocess.DEVNULL,
+                          stdout=subprocess.DEVNULL)
+    return time.perf_counter() - start
+
+
+def print_row(args, fmt, *values):
+    """Print a row of the table of results, unless --json."""
+    if not args.json:
+        print(fmt % values, flush=True)
+
+
+def print_json(args, results):
+    """Print the results as JSON, with --json."""
+    if args.json:
+        print(json.dumps(results, indent=2))
+
+
+def peak_rss(cwd):
+    """Return the VmHWM a workload script saved in rss.txt, in KB.
+    The shell reports it itself: rusage of a child forked from Python
+    would include the memory of Python."""
+    with open(os.path.join(cwd, "rss.txt")) as f:
+        return int(f.read().split()[1])
+
+
+def write_script(path, lines):
+    """Write lines to a script file; return its path."""
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    return path
+
+
+def make_workloads(tmp, n_lines):
+    """Create the workload scripts; return {name: (path, # commands)}."""
+    # the pipeline of test_cases.txt reads main.c and a dictionary
+    shutil.copy(os.path.join(SRC, "main.c"), tmp)
+    words = "/usr/share/dict/words"
+    with open(os.path.join(HERE, "test_cases.txt")) as f:
+        pipeline = f.readline().strip()
+    if not os.path.exists(words):
+        with open(os.path.join(tmp, "words"), "w") as f:
+            f.write("\n".join(sorted(["argc", "argv", "char", "int", "main",
+                                      "return", "status", "the"])) + "\n")
+        pipeline = pipeline.replace(words, "words")
+
+    tiny = ["true"] * n_lines
+    redir = []
+    for i in range(n_lines // 4):
+        redir += ["echo line %d >> log.txt" % i,
+                  "cat < log.txt > copy.txt",
+                  "wc -l < copy.txt >> counts.txt",
+                  "echo done 2> err.txt > /dev/null"]
+    redir.append("grep VmHWM /proc/$$/status > rss.txt")
+    return {
+        "empty": (write_script(os.path.join(tmp, "empty.sh"), [""]), 0),
+        "tiny": (write_script(os.path.join(tmp, "tiny.sh"), tiny), len(tiny)),
+        "redir": (write_script(os.path.join(tmp, "redir.sh"), redir), len(redir)),
+        "pipeline": (write_script(os.path.join(tmp, "pipeline.sh"), [pipeline]), 1),
+    }
+
+
+def bench_shell(shell, workloads, tmp, runs):
+    """Measure one shell; every number is the median over runs."""
+    times = {name: [] for name in workloads}
+    rss = []
+    for _ in range(runs):
+        for name, (script, _) in workloads.items():
+            for junk in ("log.txt", "copy.txt", "counts.txt"):
+                if os.path.exists(os.path.join(tmp, junk)):
+                    os.unlink(os.path.join(tmp, junk))
+            times[name].append(run_script(shell, script, tmp))
+            if name == "redir":
+                rss.append(peak_rss(tmp))
+
+    med = {name: statistics.median(t) for name, t in times.items()}
+    startup = med["empty"]
+    per_sec = lambda name: workloads[name][1] / max(med[name] - startup, 1e-9)
+    return {
+        "startup_ms": startup * 1e3,
+        "tiny_cmds_per_sec": per_sec("tiny"),
+        "redir_cmds_per_sec": per_sec("redir"),
+        "pipeline_ms": (med["pipeline"] - startup) * 1e3,
+        "peak_rss_kb": statistics.median(rss),
+    }
+
+
+def check_baseline(results, baseline, threshold):
+    """Return the list of hsh metrics which regressed."""
+    failures = []
+    for metric, higher_better in METRICS.items():
+        old, new = baseline.get(metric), results.get(metric)
+        if not old or new is None:
+            continue
+        change = (old - new) / old if higher_better else (new - old) / old
+        if change > threshold:
+            failures.append("%s: %.2f -> %.2f (%+.0f%%)" %
+                            (metric, old, new, 100 * change))
+    return failures
+
+
+def main():
+    parser = bench_parser("Compare hsh with dash and bash on scripted workloads.", runs=5)
+    parser.add_argument("--lines", type=int, default=400,
+                        help="commands per tiny/redirection workload")
+    parser.add_argument("--save", metavar="FILE")
+    parser.add_argument("--baseline", metavar="FILE")
+    parser.add_argument("--threshold", type=float, default=0.25)
+    args = parse_args(parser)
+
+    shells = {"hsh": args.hsh}
+    for name in ("dash", "bash"):
+        if shutil.which(name):
+            shells[name] = shutil.which(name)
+
+    results = {}
+    with scratch_dir(args, "shell") as tmp:
+        workloads = make_workloads(tmp, args.lines)
+        for name, path in shells.items():
+            results[name] = bench_shell(path, workloads, tmp, args.runs)
+
+    print_row(args, "%-20s" % "metric" + "%14s" * len(results), *results)
+    for metric in METRICS:
+        print_row(args, "%-20s" % metric + "%14.2f" * len(results),
+                  *(r[metric] for r in results.values()))
+    print_json(args, results)
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(results["hsh"], f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            failures = check_baseline(results["hsh"], json.load(f), args.threshold)
+        for failure in failures:
+            print("REGRESSION %s" % failure, file=sys.stderr)
+        if failures:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
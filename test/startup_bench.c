@@ -0,0 +1,128 @@
+/**
+ * startup_bench.c: measure how fast hsh starts, the way a job runner
+ * starting it thousands of times sees it:
+ *
+ * 	exit	      posix_spawn of 'hsh -c ""' until it is reaped
+ * 	first_byte    posix_spawn of 'hsh -c "echo x"' until the first
+ * 		      byte of output arrives (exec-to-first-command)
+ * 	script	      same, running a one line script file
+ *
+ * Usage: ./startup_bench [path/to/hsh] [runs]	(make bench_startup)
+ *
+ * Results are printed as JSON in the format of hsh_bench, with the
+ * median and 90th percentile of the runs in nanoseconds.
+ * @author: Henry Huang
+ * @date: 10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+/* Current time of the monotonic clock in nanoseconds */
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int dbl_cmp(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/* Start hsh once and time it.
+ * @argv: hsh command line
+ * @first_byte: non-zero to stop the clock at the first byte of
+ * 		output rather than at exit
+ * @return: elapsed nanoseconds */
+static double time_once(char **argv, int first_byte)
+{
+    int fds[2], status;
+    char c;
+    double start, elapsed;
+    pid_t pid;
+    posix_spawn_file_actions_t actions;
+
+    if (pipe(fds) == -1) {
+	perror("pipe");
+	exit(EXIT_FAILURE);
+    }
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    start = now_ns();
+    if (posix_spawn(&pid, argv[0], &actions, NULL, argv, environ)) {
+	perror(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    close(fds[1]);
+    if (first_byte && read(fds[0], &c, 1) != 1) {
+	fprintf(stderr, "startup_bench: no output from %s\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    elapsed = now_ns() - start;
+    while (read(fds[0], &c, 1) > 0)
+	;
+    waitpid(pid, &status, 0);
+    if (!first_byte)
+	elapsed = now_ns() - start;
+
+    close(fds[0]);
+    posix_spawn_file_actions_destroy(&actions);
+    return elapsed;
+}
+
+/* Time a case over runs and print its result. */
+static void run(const char *name, char **argv, int first_byte, int runs, int last)
+{
+    int i;
+    double *t = (double *) malloc(runs * sizeof(double));
+
+    time_once(argv, first_byte);		/* warm up the page cache */
+    for (i = 0; i < runs; i++)
+	t[i] = time_once(argv, first_byte);
+    qsort(t, runs, sizeof(double), dbl_cmp);
+
+    printf("  {\"group\": \"startup\", \"name\": \"%s\", \"iters\": %d, "
+	    "\"ns_per_op\": %.1f, \"p90_ns\": %.1f}%s\n", name, runs,
+	    t[runs / 2], t[runs * 9 / 10], last ? "" : ",");
+    free(t);
+}
+
+int main(int argc, char **argv)
+{
+    char *hsh = (argc > 1) ? argv[1] : "./hsh";
+    int runs = (argc > 2) ? atoi(argv[2]) : 500;
+    char script[] = "/tmp/startup_bench.XXXXXX";
+    char *exit_argv[] = { hsh, "-c", "", NULL };
+    char *echo_argv[] = { hsh, "-c", "echo x", NULL };
+    char *script_argv[] = { hsh, script, NULL };
+    int fd;
+
+    if (runs < 1 || -1 == (fd = mkstemp(script)) || write(fd, "echo x\n", 7) != 7) {
+	fprintf(stderr, "Usage: %s [path/to/hsh] [runs]\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    close(fd);
+
+    printf("{\"benchmarks\": [\n");
+    run("exit", exit_argv, 0, runs, 0);
+    run("first_byte", echo_argv, 1, runs, 0);
+    run("script first_byte", script_argv, 1, runs, 1);
+    printf("]}\n");
+
+    unlink(script);
+    return EXIT_SUCCESS;
+}